@@ -0,0 +1,384 @@
+#ifndef AUGMENTED_AVL_H
+#define AUGMENTED_AVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* Monoids for AugmentedAVLTree. A monoid names the aggregate type
+* (value_type), its identity, how a node's item becomes an aggregate
+* (lift, given the key and the value) and how two aggregates of adjacent
+* key ranges combine, the left range first. combine must be associative;
+* it need not be commutative. The monoids here aggregate the values.
+*/
+template <typename T>
+struct SumMonoid
+{
+    typedef T value_type;
+    static T identity() { return T(); }
+    template <typename Key> static T lift(const Key&, const T& value) { return value; }
+    static T combine(const T& lhs, const T& rhs) { return lhs + rhs; }
+};
+
+template <typename T>
+struct MinMonoid
+{
+    typedef T value_type;
+    static T identity() { return std::numeric_limits<T>::max(); }
+    template <typename Key> static T lift(const Key&, const T& value) { return value; }
+    static T combine(const T& lhs, const T& rhs) { return std::min(lhs, rhs); }
+};
+
+template <typename T>
+struct MaxMonoid
+{
+    typedef T value_type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template <typename Key> static T lift(const Key&, const T& value) { return value; }
+    static T combine(const T& lhs, const T& rhs) { return std::max(lhs, rhs); }
+};
+
+/**
+* An AVLNode that also caches the aggregate of every item in its subtree.
+*/
+template <typename Key, typename Value, typename Aggregate>
+class AugmentedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedAVLNode(const Key& key, const Value& value, const Aggregate& aggregate,
+                     AugmentedAVLNode<Key, Value, Aggregate>* parent);
+
+    const Aggregate& getAggregate() const;
+    void setAggregate(const Aggregate& aggregate);
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* clone() const override;
+
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getParent() const override;
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getLeft() const override;
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getRight() const override;
+
+protected:
+    Aggregate aggregate_;
+};
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the AugmentedAVLNode class.
+  ----------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>::AugmentedAVLNode(const Key& key, const Value& value, const Aggregate& aggregate,
+                                                          AugmentedAVLNode<Key, Value, Aggregate>* parent) :
+    AVLNode<Key, Value>(key, value, parent), aggregate_(aggregate)
+{
+
+}
+
+/**
+* A getter for the aggregate of the node's subtree.
+*/
+template<class Key, class Value, class Aggregate>
+const Aggregate& AugmentedAVLNode<Key, Value, Aggregate>::getAggregate() const
+{
+    return aggregate_;
+}
+
+/**
+* A setter for the aggregate of the node's subtree.
+*/
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLNode<Key, Value, Aggregate>::setAggregate(const Aggregate& aggregate)
+{
+    aggregate_ = aggregate;
+}
+
+/**
+* Copies the node, cached aggregate included.
+*/
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::clone() const
+{
+    return new AugmentedAVLNode<Key, Value, Aggregate>(*this);
+}
+
+/**
+* Overridden to return AugmentedAVLNodes, as in AVLNode, which masks off
+* the tombstone bit.
+*/
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getParent() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(AVLNode<Key, Value>::getParent());
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getLeft() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(this->child_[Node<Key, Value>::LEFT]);
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getRight() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(this->child_[Node<Key, Value>::RIGHT]);
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the AugmentedAVLNode class.
+  --------------------------------------------------
+*/
+
+/**
+* An AVLTree whose nodes cache the Monoid aggregate of their subtrees, so
+* that aggregate(lo, hi) over any key range takes O(log n) instead of a
+* walk over every item in the range. Inserts and removes refresh the
+* aggregates on the path to the root, and rotations refresh the nodes they
+* move, so updates stay O(log n).
+*
+* Change values through insert(): writing through operator[] or an
+* iterator does not refresh the cached aggregates. validate() also checks
+* every cached aggregate, which needs operator== on Monoid::value_type.
+*/
+template <class Key, class Value, class Monoid>
+class AugmentedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename Monoid::value_type aggregate_type;
+
+    aggregate_type aggregate() const;
+    aggregate_type aggregate(const Key& lo, const Key& hi) const;
+
+protected:
+    typedef AugmentedAVLNode<Key, Value, aggregate_type> AugNode;
+
+    virtual Node<Key, Value>* createNode(const std::pair<const Key, Value>& new_item, Node<Key, Value>* parent);
+    virtual void linkNode(Node<Key, Value>* parent, Node<Key, Value>* node);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void detachNode(Node<Key, Value>* node);
+    virtual void updateValue(Node<Key, Value>* node, const Value& value);
+    virtual void nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2);
+    virtual void rotate(AVLNode<Key, Value>* startingNode, bool dir);
+    virtual size_t nodeBytes() const;
+    virtual bool checkNode(Node<Key, Value>* node, int leftHeight, int rightHeight) const;
+
+    // Add helper functions here
+    static aggregate_type subtreeAggregate(AugNode* node);
+    aggregate_type itemAggregate(AugNode* node) const;
+    aggregate_type computeAggregate(AugNode* node) const;
+    void refreshPath(Node<Key, Value>* node);
+};
+
+/**
+* The aggregate of every item in the tree, in O(1).
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::aggregate_type
+AugmentedAVLTree<Key, Value, Monoid>::aggregate() const
+{
+    return subtreeAggregate(static_cast<AugNode*>(this->root_));
+}
+
+/**
+* The aggregate of the items with keys in [lo, hi], combined in key order.
+* Descends to the highest node in the range, then along the search paths
+* for lo and hi below it, taking whole cached subtrees that fall inside
+* the range: O(log n) nodes in all.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::aggregate_type
+AugmentedAVLTree<Key, Value, Monoid>::aggregate(const Key& lo, const Key& hi) const
+{
+    BST_PERF_SCOPE(OP_FIND);
+    AugNode* split = static_cast<AugNode*>(this->root_);
+    while (split != nullptr && (split->getKey() < lo || hi < split->getKey())) {
+        BST_PERF_COUNT(SW_NODES_VISITED);
+        split = (split->getKey() < lo) ? split->getRight() : split->getLeft();
+    }
+    if (split == nullptr) {
+        return Monoid::identity();
+    }
+
+    // Nodes at or above lo, with their right subtrees, are inside the
+    // range; each one found comes before those found earlier
+    aggregate_type below = Monoid::identity();
+    for (AugNode* node = split->getLeft(); node != nullptr; ) {
+        BST_PERF_COUNT(SW_NODES_VISITED);
+        if (node->getKey() < lo) {
+            node = node->getRight();
+        } else {
+            below = Monoid::combine(Monoid::combine(itemAggregate(node), subtreeAggregate(node->getRight())), below);
+            node = node->getLeft();
+        }
+    }
+    // Mirror image for hi
+    aggregate_type above = Monoid::identity();
+    for (AugNode* node = split->getRight(); node != nullptr; ) {
+        BST_PERF_COUNT(SW_NODES_VISITED);
+        if (hi < node->getKey()) {
+            node = node->getLeft();
+        } else {
+            above = Monoid::combine(above, Monoid::combine(subtreeAggregate(node->getLeft()), itemAggregate(node)));
+            node = node->getRight();
+        }
+    }
+    return Monoid::combine(Monoid::combine(below, itemAggregate(split)), above);
+}
+
+/**
+* Allocates an AugmentedAVLNode; a new leaf's aggregate is its own item's.
+*/
+template<class Key, class Value, class Monoid>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::createNode(const std::pair<const Key, Value>& new_item, Node<Key, Value>* parent)
+{
+    return new AugNode(new_item.first, new_item.second, Monoid::lift(new_item.first, new_item.second), static_cast<AugNode*>(parent));
+}
+
+/*
+ * Links and rebalances as AVLTree does, then refreshes the path from the
+ * new leaf up (which also recomputes a reinserted node's stale aggregate).
+ * Rotations on the way refreshed the nodes they moved off that path.
+ */
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::linkNode(Node<Key, Value>* parent, Node<Key, Value>* node)
+{
+    AVLTree<Key, Value>::linkNode(parent, node);
+    refreshPath(node);
+}
+
+/*
+ * Removes as AVLTree does. An unlinked node is handled by detachNode();
+ * a node only marked as a tombstone needs the path from it refreshed.
+ */
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::removeNode(Node<Key, Value>* node)
+{
+    bool lazy = this->maxTombstoneRatio_ > 0.0;
+    AVLTree<Key, Value>::removeNode(node);
+    if (lazy) {
+        refreshPath(node); // otherwise detachNode() refreshed the path
+    }
+}
+
+/*
+ * Unlinks as AVLTree does, then refreshes the path up from where a node
+ * was unlinked: the predecessor's old place when node had two children.
+ */
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::detachNode(Node<Key, Value>* node)
+{
+    Node<Key, Value>* refreshFrom;
+    if (node->getLeft() != nullptr && node->getRight() != nullptr) {
+        Node<Key, Value>* pred = this->predecessor(node);
+        refreshFrom = (pred->getParent() == node) ? pred : pred->getParent();
+    } else {
+        refreshFrom = node->getParent();
+    }
+    AVLTree<Key, Value>::detachNode(node);
+    refreshPath(refreshFrom);
+}
+
+/**
+* Overwrites the value, then refreshes the path from node up.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::updateValue(Node<Key, Value>* node, const Value& value)
+{
+    node->setValue(value);
+    refreshPath(node);
+}
+
+/**
+* Swaps as AVLTree does, and swaps the cached aggregates with the
+* positions: each subtree still holds the same items.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2)
+{
+    AVLTree<Key, Value>::nodeSwap(n1, n2);
+    AugNode* a1 = static_cast<AugNode*>(n1);
+    AugNode* a2 = static_cast<AugNode*>(n2);
+    aggregate_type temp = a1->getAggregate();
+    a1->setAggregate(a2->getAggregate());
+    a2->setAggregate(temp);
+}
+
+/**
+* Rotates as AVLTree does, then recomputes the two nodes whose subtrees
+* changed, the lower one first.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rotate(AVLNode<Key, Value>* startingNode, bool dir)
+{
+    AVLTree<Key, Value>::rotate(startingNode, dir);
+    AugNode* lowered = static_cast<AugNode*>(startingNode);
+    lowered->setAggregate(computeAggregate(lowered));
+    lowered->getParent()->setAggregate(computeAggregate(lowered->getParent()));
+}
+
+template<class Key, class Value, class Monoid>
+size_t AugmentedAVLTree<Key, Value, Monoid>::nodeBytes() const
+{
+    return sizeof(AugNode);
+}
+
+/**
+* Checks the AVL balance, and that the cached aggregate matches the one
+* computed from the node's children. Called by validate().
+*/
+template<class Key, class Value, class Monoid>
+bool AugmentedAVLTree<Key, Value, Monoid>::checkNode(Node<Key, Value>* node, int leftHeight, int rightHeight) const
+{
+    AugNode* augNode = static_cast<AugNode*>(node);
+    return AVLTree<Key, Value>::checkNode(node, leftHeight, rightHeight)
+        && augNode->getAggregate() == computeAggregate(augNode);
+}
+
+/**
+* The cached aggregate of the subtree under node; the identity if null.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::aggregate_type
+AugmentedAVLTree<Key, Value, Monoid>::subtreeAggregate(AugNode* node)
+{
+    return node == nullptr ? Monoid::identity() : node->getAggregate();
+}
+
+/**
+* The aggregate of node's own item; the identity for a tombstone.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::aggregate_type
+AugmentedAVLTree<Key, Value, Monoid>::itemAggregate(AugNode* node) const
+{
+    return this->isLive(node) ? Monoid::lift(node->getKey(), node->getValue()) : Monoid::identity();
+}
+
+/**
+* The aggregate of node's subtree from its item and its children's
+* cached aggregates.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::aggregate_type
+AugmentedAVLTree<Key, Value, Monoid>::computeAggregate(AugNode* node) const
+{
+    return Monoid::combine(Monoid::combine(subtreeAggregate(node->getLeft()), itemAggregate(node)),
+                           subtreeAggregate(node->getRight()));
+}
+
+/**
+* Recomputes the aggregates of node and each of its ancestors.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refreshPath(Node<Key, Value>* node)
+{
+    for (AugNode* curr = static_cast<AugNode*>(node); curr != nullptr; curr = curr->getParent()) {
+        curr->setAggregate(computeAggregate(curr));
+    }
+}
+
+#endif
@@ -6,14 +6,16 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
 #include "bst.h"
 
 struct KeyError { };
 
 /**
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
-* other additional helper functions. You do NOT need to implement any functionality or
-* add additional data members or helper functions.
+* other additional helper functions. For lazy removal it also keeps the tombstone bit in
+* its parent pointer, hidden by getParent and setParent, and a flag marking the subtrees
+* that may hold tombstones, which both fit in the space a plain AVL node already takes.
 */
 template <typename Key, typename Value>
 class AVLNode : public Node<Key, Value>
@@ -28,15 +30,26 @@ public:
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
+    // Getters/setters for lazy removal.
+    void setTombstone(bool tombstone);
+    bool mayHoldTombstones() const;
+    void setMayHoldTombstones(bool mayHold);
+    virtual AVLNode<Key, Value>* clone() const override;
+
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
     // for more information.
     virtual AVLNode<Key, Value>* getParent() const override;
     virtual AVLNode<Key, Value>* getLeft() const override;
     virtual AVLNode<Key, Value>* getRight() const override;
+    virtual void setParent(Node<Key, Value>* parent) override;
 
 protected:
     int8_t balance_;    // effectively a signed char
+    // True if this node or one below it may be a tombstone. It is set on
+    // every ancestor of a tombstone, and a node that has it set has it set
+    // on all its ancestors too. Sits in padding after balance_.
+    bool mayHoldTombstones_;
 };
 
 /*
@@ -50,7 +63,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), mayHoldTombstones_(false)
 {
 
 }
@@ -91,6 +104,43 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
     balance_ += diff;
 }
 
+/**
+* A setter for the tombstone bit of a AVLNode, read by Node::isTombstone.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setTombstone(bool tombstone)
+{
+    uintptr_t bits = reinterpret_cast<uintptr_t>(this->parent_) & ~Node<Key, Value>::TOMBSTONE_BIT;
+    this->parent_ = reinterpret_cast<Node<Key, Value>*>(bits | (tombstone ? Node<Key, Value>::TOMBSTONE_BIT : 0));
+}
+
+/**
+* Whether a tombstone may sit at or below this node.
+*/
+template<class Key, class Value>
+bool AVLNode<Key, Value>::mayHoldTombstones() const
+{
+    return mayHoldTombstones_;
+}
+
+/**
+* A setter for the flag read by mayHoldTombstones().
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setMayHoldTombstones(bool mayHold)
+{
+    mayHoldTombstones_ = mayHold;
+}
+
+/**
+* Copies the node, balance and tombstone flags included.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLNode<Key, Value>::clone() const
+{
+    return new AVLNode<Key, Value>(*this);
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -98,7 +148,8 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->parent_);
+    uintptr_t bits = reinterpret_cast<uintptr_t>(this->parent_);
+    return reinterpret_cast<AVLNode<Key, Value>*>(bits & ~Node<Key, Value>::TOMBSTONE_BIT);
 }
 
 /**
@@ -107,7 +158,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return static_cast<AVLNode<Key, Value>*>(this->child_[Node<Key, Value>::LEFT]);
 }
 
 /**
@@ -116,7 +167,17 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    return static_cast<AVLNode<Key, Value>*>(this->child_[Node<Key, Value>::RIGHT]);
+}
+
+/**
+* Sets the parent while keeping this node's tombstone bit.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setParent(Node<Key, Value>* parent)
+{
+    uintptr_t tombstone = reinterpret_cast<uintptr_t>(this->parent_) & Node<Key, Value>::TOMBSTONE_BIT;
+    this->parent_ = reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(parent) | tombstone);
 }
 
 
@@ -131,76 +192,184 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
-    virtual void insert(const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
+    AVLTree();
+    void enableLazyRemove(double maxTombstoneRatio);
+    bool needsCompaction() const;
+    virtual void compact();
+    virtual void swap(BinarySearchTree<Key, Value>& other);
 protected:
+    virtual Node<Key, Value>* createNode(const std::pair<const Key, Value>& new_item, Node<Key, Value>* parent);
+    virtual void linkNode(Node<Key, Value>* parent, Node<Key, Value>* node);
+    virtual void reviveNode(Node<Key, Value>* node);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void detachNode(Node<Key, Value>* node);  // TODO
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual size_t nodeBytes() const;
+    virtual bool checkNode(Node<Key, Value>* node, int leftHeight, int rightHeight) const;
 
     // Add helper functions here
+    virtual void rotate(AVLNode<Key, Value>* startingNode, bool dir);
     void leftRotation(AVLNode<Key, Value>* startingNode);
     void rightRotation(AVLNode<Key, Value>* startingNode);
+    void collectTombstones(std::vector<Node<Key, Value>*>& dead);
+
+    // Lazy removal is on while this is above zero (see enableLazyRemove)
+    double maxTombstoneRatio_;
 };
 
-/*
- * Recall: If key is already in the tree, you should 
- * overwrite the current value with the updated value.
- */
 template<class Key, class Value>
-void AVLTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item) {
-  // TODO
-  AVLNode<Key, Value>* currNode = static_cast<AVLNode<Key, Value>*>(this->internalFind(new_item.first));
-    if (currNode != nullptr) {
-        currNode->setValue(new_item.second); // Overwrite the value if the key exists
-        return;
+AVLTree<Key, Value>::AVLTree() : maxTombstoneRatio_(0.0)
+{
+
+}
+
+/**
+* Swaps the trees, lazy removal settings included.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::swap(BinarySearchTree<Key, Value>& other)
+{
+    BinarySearchTree<Key, Value>::swap(other);
+    std::swap(maxTombstoneRatio_, static_cast<AVLTree<Key, Value>&>(other).maxTombstoneRatio_);
+}
+
+/**
+* Switches remove() to lazy mode: a removed key's node is only marked as
+* a tombstone, with no unlinking, swapping or rotation. Lookups and
+* iteration skip tombstones, and re-inserting the key revives its node.
+* remove() never compacts: once tombstones make up more than
+* maxTombstoneRatio of the linked nodes, needsCompaction() returns true,
+* and it is up to the caller to call compact() when it suits it. Until
+* then tombstones keep their memory and lengthen searches. A ratio of 0
+* (the default) turns lazy mode off, compacting first.
+*
+* The unlinking is deferred, not saved: a remove costs its search and the
+* marking, and compaction later pays for the unlinking and rebalancing
+* that an eager remove does at once. Lazy mode suits bursts of removes
+* that must return quickly, with compaction left to a quieter moment, and
+* keys that are often removed and soon inserted again, whose nodes are
+* revived in place.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::enableLazyRemove(double maxTombstoneRatio)
+{
+    maxTombstoneRatio_ = maxTombstoneRatio;
+    if (maxTombstoneRatio_ <= 0.0) {
+        compact();
     }
+}
 
-    // Step 2: Perform a standard BST insert
-    AVLNode<Key, Value>* parentNode = nullptr;
-    currNode = static_cast<AVLNode<Key, Value>*>(this->root_);
+/**
+* Returns true once tombstones make up more than the ratio given to
+* enableLazyRemove() of the linked nodes, and compact() is due.
+*/
+template<class Key, class Value>
+bool AVLTree<Key, Value>::needsCompaction() const
+{
+    return this->tombstones_ > maxTombstoneRatio_ * (this->size_ + this->tombstones_);
+}
 
-    while (currNode != nullptr) {
-        parentNode = currNode;
+/**
+* Unlinks and deletes every tombstone, rebalancing as an eager remove
+* does. Only the paths down to tombstones are walked, so the cost grows
+* with the number of tombstones t, not with the size of the tree: O(t log
+* n), which for a large t is a long pause. The live nodes keep their
+* places. Never called by remove().
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compact()
+{
+    if (this->tombstones_ == 0) {
+        return;
+    }
+    std::vector<Node<Key, Value>*> dead;
+    dead.reserve(this->tombstones_);
+    collectTombstones(dead);
+    for (size_t i = 0; i < dead.size(); ++i) {
+        // Counted as live again for the moment, as detachNode() takes
+        // the node off size_
+        --this->tombstones_;
+        ++this->size_;
+        BinarySearchTree<Key, Value>::removeNode(dead[i]);
+    }
+}
 
-        if (new_item.first < currNode->getKey()) {
-            currNode = currNode->getLeft();
-        } else {
-            currNode = currNode->getRight();
+/**
+* Appends every tombstone to dead in key order, following only the
+* subtrees flagged as possibly holding one, and clears those flags.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::collectTombstones(std::vector<Node<Key, Value>*>& dead)
+{
+    std::vector<AVLNode<Key, Value>*> stack;
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->root_);
+    while (node != nullptr || !stack.empty()) {
+        if (node != nullptr && node->mayHoldTombstones()) {
+            node->setMayHoldTombstones(false);
+            stack.push_back(node);
+            node = node->getLeft();
+            continue;
+        }
+        if (stack.empty()) {
+            break;
         }
+        node = stack.back();
+        stack.pop_back();
+        if (node->isTombstone()) {
+            dead.push_back(node);
+        }
+        node = node->getRight();
     }
+}
 
-    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, parentNode);
-    if (parentNode == nullptr) {
-        this->root_ = newNode; // Tree was empty, set root
-    } else if (new_item.first < parentNode->getKey()) {
-        parentNode->setLeft(newNode);
-    } else {
-        parentNode->setRight(newNode);
-    }
+/**
+* Clears the tombstone flag of a node revived by an insert.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::reviveNode(Node<Key, Value>* node)
+{
+    static_cast<AVLNode<Key, Value>*>(node)->setTombstone(false);
+    BinarySearchTree<Key, Value>::reviveNode(node);
+}
 
-    // Step 3: Update balances and perform rotations
-    currNode = newNode;
+/**
+* Allocates an AVLNode; new leaves are balanced.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::createNode(const std::pair<const Key, Value>& new_item, Node<Key, Value>* parent) {
+  return new AVLNode<Key, Value>(new_item.first, new_item.second, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+/*
+ * Links the leaf (every insert, and inserting an extracted node, ends
+ * here), then walks up updating balances. At most one single or double
+ * rotation is needed.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::linkNode(Node<Key, Value>* parent, Node<Key, Value>* node) {
+  AVLNode<Key, Value>* newNode = static_cast<AVLNode<Key, Value>*>(node);
+  newNode->setBalance(0);
+  newNode->setTombstone(false);
+  newNode->setMayHoldTombstones(false);
+  BinarySearchTree<Key, Value>::linkNode(parent, newNode);
+  AVLNode<Key, Value>* parentNode = newNode->getParent();
+
+    // Update balances and perform rotations. dir is the side of
+    // parentNode that grew; sign is the balance change that causes.
+    AVLNode<Key, Value>* currNode = newNode;
     while (parentNode != nullptr) {
-        if (currNode == parentNode->getLeft()) {
-            parentNode->updateBalance(-1);
-        } else {
-            parentNode->updateBalance(1);
-        }
+        bool dir = (currNode == parentNode->getRight());
+        int sign = dir ? 1 : -1;
+        parentNode->updateBalance(sign);
 
         if (parentNode->getBalance() == 0) {
             break; // Tree is balanced
-        } else if (parentNode->getBalance() == -2) {
-            // Left-heavy
-            if (currNode->getBalance() == 1) {
-                leftRotation(currNode);
-            }
-            rightRotation(parentNode);
-            break;
-        } else if (parentNode->getBalance() == 2) {
-            // Right-heavy
-            if (currNode->getBalance() == -1) {
-                rightRotation(currNode);
+        } else if (parentNode->getBalance() == 2 * sign) {
+            // Heavy on the dir side; double rotation if currNode leans inward
+            if (currNode->getBalance() == -sign) {
+                rotate(currNode, dir);
             }
-            leftRotation(parentNode);
+            rotate(parentNode, !dir);
             break;
         }
 
@@ -209,18 +378,36 @@ void AVLTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item) {
     }
 }
 
+/**
+* In lazy mode, marks node as a tombstone, leaving compaction to the
+* caller (see needsCompaction()); otherwise unlinks and deletes it.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(Node<Key, Value>* node) {
+  AVLNode<Key, Value>* currNode = static_cast<AVLNode<Key, Value>*>(node);
+    if (maxTombstoneRatio_ > 0.0) {
+        // Lazy mode: mark the node and leave the tree's shape alone.
+        // The flag climbs until it meets an ancestor that already has it.
+        this->moveExtremesOff(currNode);
+        currNode->setTombstone(true);
+        for (AVLNode<Key, Value>* up = currNode; up != nullptr && !up->mayHoldTombstones(); up = up->getParent()) {
+            up->setMayHoldTombstones(true);
+        }
+        --this->size_;
+        ++this->tombstones_;
+        return;
+    }
+    BinarySearchTree<Key, Value>::removeNode(node);
+}
+
 /*
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
  */
 template<class Key, class Value>
-void AVLTree<Key, Value>::remove(const Key& key) {
+void AVLTree<Key, Value>::detachNode(Node<Key, Value>* node) {
   // TODO
-  AVLNode<Key, Value>* currNode = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
-    if (currNode == nullptr) {
-        return; // Key not found
-    }
-
+  AVLNode<Key, Value>* currNode = static_cast<AVLNode<Key, Value>*>(node);
     AVLNode<Key, Value>* parentNode = currNode->getParent();
     bool isLeftChild = (parentNode != nullptr && currNode == parentNode->getLeft());
 
@@ -250,36 +437,35 @@ void AVLTree<Key, Value>::remove(const Key& key) {
         }
     }
 
-    delete currNode;
+    --this->size_;
 
-    // Step 3: Update balances and perform rotations
+    // Step 3: Update balances and perform rotations. dir is the side of
+    // curr that shrank; sign is the balance change that causes.
     AVLNode<Key, Value>* curr = parentNode;
+    bool dir = !isLeftChild;
     while (curr != nullptr) {
-        if (isLeftChild) {
-            curr->updateBalance(1); // Removing from left increases balance
-        } else {
-            curr->updateBalance(-1); // Removing from right decreases balance
+        int sign = dir ? -1 : 1;
+        curr->updateBalance(sign);
+
+        if (curr->getBalance() == 1 || curr->getBalance() == -1) {
+            break; // Subtree height did not change
         }
 
-        if (curr->getBalance() == 2) {
-            AVLNode<Key, Value>* rightChild = curr->getRight();
-            if (rightChild->getBalance() == -1) {
-                rightRotation(rightChild);
+        if (curr->getBalance() == 2 * sign) {
+            // Heavy on the other side; double rotation if that child leans back
+            AVLNode<Key, Value>* otherChild = static_cast<AVLNode<Key, Value>*>(curr->getChild(!dir));
+            if (otherChild->getBalance() == -sign) {
+                rotate(otherChild, !dir);
             }
-            leftRotation(curr);
-        } else if (curr->getBalance() == -2) {
-            AVLNode<Key, Value>* leftChild = curr->getLeft();
-            if (leftChild->getBalance() == 1) {
-                leftRotation(leftChild);
-            }
-            rightRotation(curr);
+            rotate(curr, dir);
+            curr = curr->getParent();
         }
 
         if (curr->getBalance() != 0) {
-            break; // Stop if balance is restored
+            break; // Rotated subtree kept its height
         }
 
-        isLeftChild = (curr->getParent() != nullptr && curr == curr->getParent()->getLeft());
+        dir = (curr->getParent() != nullptr && curr == curr->getParent()->getRight());
         curr = curr->getParent();
     }
 }
@@ -291,58 +477,63 @@ void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>*
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
+    // Like the balance, the subtree flag belongs to the position
+    bool tempM = n1->mayHoldTombstones();
+    n1->setMayHoldTombstones(n2->mayHoldTombstones());
+    n2->setMayHoldTombstones(tempM);
 }
 
 template<class Key, class Value>
-void AVLTree<Key, Value>::leftRotation(AVLNode<Key, Value>* startingNode) {
-  AVLNode<Key, Value>* rightChild = startingNode->getRight();
-    rightChild->setParent(startingNode->getParent());
-
-    if (startingNode == this->root_) {
-        this->root_ = rightChild; // Update root if necessary
-    } else if (startingNode == startingNode->getParent()->getLeft()) {
-        startingNode->getParent()->setLeft(rightChild);
-    } else {
-        startingNode->getParent()->setRight(rightChild);
-    }
+size_t AVLTree<Key, Value>::nodeBytes() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
 
-    startingNode->setRight(rightChild->getLeft());
-    if (rightChild->getLeft() != nullptr) {
-        rightChild->getLeft()->setParent(startingNode);
-    }
+/**
+* Checks that the stored balance of an AVL node matches the heights of its
+* subtrees and is within [-1, 1], and that a tombstone, or a child that
+* may hold one, is flagged as such. Called by validate().
+*/
+template<class Key, class Value>
+bool AVLTree<Key, Value>::checkNode(Node<Key, Value>* node, int leftHeight, int rightHeight) const
+{
+    AVLNode<Key, Value>* avlNode = static_cast<AVLNode<Key, Value>*>(node);
+    int8_t balance = avlNode->getBalance();
+    bool below = (avlNode->getLeft() != nullptr && avlNode->getLeft()->mayHoldTombstones())
+              || (avlNode->getRight() != nullptr && avlNode->getRight()->mayHoldTombstones());
+    return balance == rightHeight - leftHeight && balance >= -1 && balance <= 1
+        && (avlNode->mayHoldTombstones() || (!avlNode->isTombstone() && !below));
+}
 
-    rightChild->setLeft(startingNode);
-    startingNode->setParent(rightChild);
+/**
+* Rotates startingNode down in direction dir and updates the two balances
+* that change. The formulas are for a left rotation (a and b the old
+* balances of startingNode and the rising child); a right rotation is
+* its mirror image, so the balances are negated going in and coming out.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::rotate(AVLNode<Key, Value>* startingNode, bool dir) {
+  AVLNode<Key, Value>* riser = static_cast<AVLNode<Key, Value>*>(BinarySearchTree<Key, Value>::rotate(startingNode, dir));
+  // riser's subtree is now the one startingNode had, and startingNode's
+  // is part of it, so both flags stay right
+  riser->setMayHoldTombstones(startingNode->mayHoldTombstones());
+  int sign = (dir == Node<Key, Value>::LEFT) ? 1 : -1;
+  int a = sign * startingNode->getBalance();
+  int b = sign * riser->getBalance();
+  int newA = a - 1 - std::max(b, 0);
+  int newB = b - 1 + std::min(newA, 0);
+  startingNode->setBalance((int8_t)(sign * newA));
+  riser->setBalance((int8_t)(sign * newB));
+}
 
-    // Update balances
-    rightChild->setBalance(rightChild->getBalance() - 1);
-    startingNode->setBalance(startingNode->getBalance() - 2);
+template<class Key, class Value>
+void AVLTree<Key, Value>::leftRotation(AVLNode<Key, Value>* startingNode) {
+  rotate(startingNode, Node<Key, Value>::LEFT);
 }
 
 template<class Key, class Value>
 void AVLTree<Key, Value>::rightRotation(AVLNode<Key, Value>* startingNode) {
-  AVLNode<Key, Value>* leftChild = startingNode->getLeft();
-    leftChild->setParent(startingNode->getParent());
-
-    if (startingNode == this->root_) {
-        this->root_ = leftChild; // Update root if necessary
-    } else if (startingNode == startingNode->getParent()->getLeft()) {
-        startingNode->getParent()->setLeft(leftChild);
-    } else {
-        startingNode->getParent()->setRight(leftChild);
-    }
-
-    startingNode->setLeft(leftChild->getRight());
-    if (leftChild->getRight() != nullptr) {
-        leftChild->getRight()->setParent(startingNode);
-    }
-
-    leftChild->setRight(startingNode);
-    startingNode->setParent(leftChild);
-
-    // Update balances
-    leftChild->setBalance(leftChild->getBalance() + 1);
-    startingNode->setBalance(startingNode->getBalance() + 2);
+  rotate(startingNode, Node<Key, Value>::RIGHT);
 }
 
 
@@ -0,0 +1,1139 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include "bst.h"
+#include "avlbst.h"
+#include "compact-avl.h"
+#include "stack-avl.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "scapegoatbst.h"
+#include "augmented-avl.h"
+#include "interval-avl.h"
+#include "veb-snapshot.h"
+#include "radix-tree.h"
+
+using namespace std;
+
+// Benchmarks for the search tree variants.
+// Usage: ./bst-bench [-n keys] [section ...]
+// With no sections, every section is run. Keys default to 1000000.
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the optimizer from dropping lookups whose results are unused.
+volatile long benchSink;
+
+// Bytes per node as each tree reports it.
+template<typename Key, typename Value>
+double nodeBytes(const BinarySearchTree<Key, Value>& tree)
+{
+    return tree.size() == 0 ? 0.0 : (double)tree.stats().bytesUsed / tree.size();
+}
+
+template<typename Key, typename Value>
+double nodeBytes(const CompactAVLTree<Key, Value>& tree)
+{
+    return tree.size() == 0 ? 0.0 : (double)tree.bytesUsed() / tree.size();
+}
+
+template<typename Key, typename Value>
+double nodeBytes(const StackAVLTree<Key, Value>&)
+{
+    return sizeof(StackAVLNode<Key, Value>);
+}
+
+void printHeader()
+{
+    cout << setw(16) << "tree" << setw(12) << "insert ns" << setw(12) << "find ns"
+         << setw(12) << "iter ns" << setw(12) << "remove ns" << setw(12) << "bytes/node" << endl;
+}
+
+// Inserts, finds (in a different random order), iterates and removes
+// every key, reporting ns per operation for each phase.
+template<typename Tree>
+void runOps(const char* name, const vector<int>& keys, const vector<int>& probes)
+{
+    Tree tree;
+    size_t n = keys.size();
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], keys[i]));
+    }
+    double insertTime = secondsSince(start);
+    double bytes = nodeBytes(tree);
+
+    long sum = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += tree.find(probes[i])->second;
+    }
+    double findTime = secondsSince(start);
+
+    start = Clock::now();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    double iterTime = secondsSince(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        tree.remove(probes[i]);
+    }
+    double removeTime = secondsSince(start);
+    benchSink = sum;
+
+    cout << setw(16) << name << fixed << setprecision(1)
+         << setw(12) << insertTime * 1e9 / n << setw(12) << findTime * 1e9 / n
+         << setw(12) << iterTime * 1e9 / n << setw(12) << removeTime * 1e9 / n
+         << setw(12) << bytes << endl;
+}
+
+// Parent pointers (AVLTree) against descent-path stacks (StackAVLTree)
+// and against 32-bit pool indices (CompactAVLTree).
+void benchModes(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), rng);
+
+    cout << "Node representations, " << n << " random int keys" << endl;
+    printHeader();
+    runOps<AVLTree<int, int> >("AVLTree", keys, probes);
+    runOps<StackAVLTree<int, int> >("StackAVLTree", keys, probes);
+    runOps<CompactAVLTree<int, int> >("CompactAVLTree", keys, probes);
+}
+
+// Draws ranks 0..n-1 with P(rank) proportional to 1 / (rank + 1)^skew.
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(size_t n, double skew) : cdf_(n)
+    {
+        double total = 0;
+        for (size_t i = 0; i < n; ++i) {
+            total += 1.0 / pow((double)(i + 1), skew);
+            cdf_[i] = total;
+        }
+        for (size_t i = 0; i < n; ++i) cdf_[i] /= total;
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng)
+    {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+    }
+
+private:
+    vector<double> cdf_;
+};
+
+// Times one lookup per probe. Splay trees are looked up through their
+// non-const find so that they restructure.
+template<typename Tree>
+double timeLookups(Tree& tree, const vector<int>& probes)
+{
+    long sum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        sum += tree.find(probes[i])->second;
+    }
+    double elapsed = secondsSince(start);
+    benchSink = sum;
+    return elapsed * 1e9 / probes.size();
+}
+
+// AVLTree against SplayTree for uniform and Zipfian (skewed) lookups.
+// Hot ranks are mapped to random keys so that skew does not imply locality.
+void benchSplay(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    AVLTree<int, int> avl;
+    SplayTree<int, int> splay;
+    for (size_t i = 0; i < n; ++i) {
+        avl.insert(make_pair(keys[i], keys[i]));
+        splay.insert(make_pair(keys[i], keys[i]));
+    }
+
+    cout << "Lookups on " << n << " int keys (ns per find)" << endl;
+    cout << setw(16) << "workload" << setw(12) << "AVLTree" << setw(12) << "SplayTree" << endl;
+    const double skews[] = { 0.0, 0.8, 0.99, 1.2 };
+    for (size_t s = 0; s < sizeof(skews) / sizeof(skews[0]); ++s) {
+        vector<int> probes(n);
+        if (skews[s] == 0.0) {
+            for (size_t i = 0; i < n; ++i) probes[i] = keys[rng() % n];
+        } else {
+            ZipfGenerator zipf(n, skews[s]);
+            for (size_t i = 0; i < n; ++i) probes[i] = keys[zipf(rng)];
+        }
+        double avlTime = timeLookups(avl, probes);
+        double splayTime = timeLookups(splay, probes);
+        ostringstream label;
+        if (skews[s] == 0.0) label << "uniform";
+        else label << "zipf " << skews[s];
+        cout << setw(16) << label.str() << fixed << setprecision(1)
+             << setw(12) << avlTime << setw(12) << splayTime << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// Write-heavy churn: after filling the tree, each round removes a random
+// present key and inserts a fresh one. Reports ns and rotations per write.
+template<typename Tree>
+void runWrites(const char* name, const vector<int>& keys, size_t rounds)
+{
+    Tree tree;
+    size_t n = keys.size();
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], keys[i]));
+    }
+    TreeStats before = tree.stats();
+
+    // Slots hold the keys currently in the tree; fresh keys start at n
+    vector<int> present = keys;
+    mt19937 rng(34);
+    int next = (int)n;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        size_t slot = rng() % n;
+        tree.remove(present[slot]);
+        present[slot] = next++;
+        tree.insert(make_pair(present[slot], 0));
+    }
+    double elapsed = secondsSince(start);
+    TreeStats after = tree.stats();
+    size_t rotations = (after.leftRotations + after.rightRotations)
+                     - (before.leftRotations + before.rightRotations);
+
+    cout << setw(16) << name << fixed << setprecision(1)
+         << setw(12) << elapsed * 1e9 / (2 * rounds)
+         << setw(14) << setprecision(3) << (double)rotations / (2 * rounds)
+         << setw(12) << after.height << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// AVLTree against RedBlackTree on a remove/insert churn workload.
+void benchWrites(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    cout << "Write churn on " << n << " int keys (" << n << " removes + inserts)" << endl;
+    cout << setw(16) << "tree" << setw(12) << "ns/write" << setw(14) << "rotations/op"
+         << setw(12) << "height" << endl;
+    runWrites<AVLTree<int, int> >("AVLTree", keys, n);
+    runWrites<RedBlackTree<int, int> >("RedBlackTree", keys, n);
+}
+
+// Balance-field-free ScapegoatTree against the balanced trees, for keys
+// inserted in random order and in ascending order.
+void benchScapegoat(size_t n)
+{
+    vector<int> sorted(n);
+    for (size_t i = 0; i < n; ++i) sorted[i] = (int)i;
+    vector<int> keys = sorted;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), rng);
+
+    cout << "Balancing schemes, " << n << " random int keys" << endl;
+    printHeader();
+    runOps<AVLTree<int, int> >("AVLTree", keys, probes);
+    runOps<RedBlackTree<int, int> >("RedBlackTree", keys, probes);
+    runOps<ScapegoatTree<int, int> >("ScapegoatTree", keys, probes);
+
+    cout << endl << "Balancing schemes, " << n << " ascending int keys" << endl;
+    printHeader();
+    runOps<AVLTree<int, int> >("AVLTree", sorted, probes);
+    runOps<RedBlackTree<int, int> >("RedBlackTree", sorted, probes);
+    runOps<ScapegoatTree<int, int> >("ScapegoatTree", sorted, probes);
+}
+
+// Lookups where 95% of probes hit 1% of the keys, with and without the
+// hot-key lookup cache.
+void benchHotKeys(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    size_t hot = n / 100 > 0 ? n / 100 : 1;
+    vector<int> probes(n);
+    for (size_t i = 0; i < n; ++i) {
+        probes[i] = (rng() % 100 < 95) ? keys[rng() % hot] : keys[rng() % n];
+    }
+
+    AVLTree<int, int> tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], keys[i]));
+    }
+    cout << "Hot-key lookups on " << n << " int keys, 95% of probes on "
+         << hot << " keys (ns per find)" << endl;
+    cout << setw(16) << "cache slots" << setw(12) << "AVLTree" << endl;
+    const size_t slots[] = { 0, hot, 2 * hot, 4 * hot };
+    for (size_t s = 0; s < sizeof(slots) / sizeof(slots[0]); ++s) {
+        tree.enableLookupCache(slots[s]);
+        timeLookups(tree, probes); // warm the cache
+        double elapsed = timeLookups(tree, probes);
+        cout << setw(16) << slots[s] << fixed << setprecision(1) << setw(12) << elapsed << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// Times inserting keys in order, either from the root or hinted with the
+// position of the previous insert.
+template<typename Tree>
+double timeInserts(const vector<int>& keys, bool hinted)
+{
+    Tree tree;
+    typename Tree::iterator hint = tree.end();
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (hinted) {
+            hint = tree.insert(hint, make_pair(keys[i], keys[i]));
+        } else {
+            tree.insert(make_pair(keys[i], keys[i]));
+        }
+    }
+    return secondsSince(start) * 1e9 / keys.size();
+}
+
+template<typename Tree>
+void runHinted(const char* name, const vector<int>& sorted, const vector<int>& nearSorted)
+{
+    cout << setw(16) << name << fixed << setprecision(1)
+         << setw(12) << timeInserts<Tree>(sorted, false) << setw(12) << timeInserts<Tree>(sorted, true)
+         << setw(12) << timeInserts<Tree>(nearSorted, false) << setw(12) << timeInserts<Tree>(nearSorted, true)
+         << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// Plain against hinted inserts for ascending keys and for timestamps that
+// arrive slightly out of order (each key displaced by up to 16 places).
+void benchHinted(size_t n)
+{
+    vector<int> sorted(n);
+    for (size_t i = 0; i < n; ++i) sorted[i] = (int)i;
+    vector<int> nearSorted = sorted;
+    mt19937 rng(104);
+    for (size_t i = 0; i + 16 < n; i += 16) {
+        shuffle(nearSorted.begin() + i, nearSorted.begin() + i + 16, rng);
+    }
+
+    cout << "Inserts of " << n << " ordered int keys (ns per insert)" << endl;
+    cout << setw(16) << "tree" << setw(12) << "sorted" << setw(12) << "hinted"
+         << setw(12) << "near" << setw(12) << "hinted" << endl;
+    runHinted<AVLTree<int, int> >("AVLTree", sorted, nearSorted);
+    runHinted<RedBlackTree<int, int> >("RedBlackTree", sorted, nearSorted);
+}
+
+// Times for one run of timeBursts(), in ns.
+struct BurstTimes
+{
+    double perOp;
+    double perRemove;
+};
+
+// Expiry-style churn over a sliding window of timestamps: each tick
+// removes the oldest burst keys and inserts burst new keys. ratio 0
+// removes eagerly; in lazy mode the tree is compacted between the
+// removes and the inserts whenever needsCompaction() says so. With
+// viaBegin, the oldest key is read through begin() before each remove,
+// as an expiry loop would. perOp covers the removes, the compactions and
+// the inserts; perRemove the removes alone.
+BurstTimes timeBursts(size_t n, size_t burst, double ratio, bool viaBegin)
+{
+    AVLTree<int, int> tree;
+    tree.enableLazyRemove(ratio);
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair((int)i, 0));
+    }
+    int oldest = 0;
+    int next = (int)n;
+    size_t ticks = n / burst;
+    double removeSeconds = 0;
+    double otherSeconds = 0;
+    for (size_t t = 0; t < ticks; ++t) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < burst; ++i) {
+            tree.remove(viaBegin ? tree.begin()->first : oldest++);
+        }
+        removeSeconds += secondsSince(start);
+        start = Clock::now();
+        if (tree.needsCompaction()) {
+            tree.compact();
+        }
+        for (size_t i = 0; i < burst; ++i) {
+            tree.insert(make_pair(next++, 0));
+        }
+        otherSeconds += secondsSince(start);
+    }
+    benchSink = (long)tree.size();
+    BurstTimes times;
+    times.perOp = (removeSeconds + otherSeconds) * 1e9 / (2 * ticks * burst);
+    times.perRemove = removeSeconds * 1e9 / (ticks * burst);
+    return times;
+}
+
+// Eager against lazy removal for bursts of expiring keys, removed by
+// key and through begin().
+void benchLazy(size_t n)
+{
+    size_t burst = n / 100 > 0 ? n / 100 : 1;
+
+    cout << "AVLTree expiry bursts of " << burst << " on " << n
+         << " int keys (ns per call)" << endl;
+    cout << setw(16) << "mode" << setw(12) << "ns/op" << setw(12) << "remove"
+         << setw(16) << "begin()+remove" << endl;
+    const double ratios[] = { 0.0, 0.1, 0.25, 0.5 };
+    for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); ++r) {
+        ostringstream label;
+        if (ratios[r] == 0.0) label << "eager";
+        else label << "lazy " << ratios[r];
+        BurstTimes byKey = timeBursts(n, burst, ratios[r], false);
+        BurstTimes byBegin = timeBursts(n, burst, ratios[r], true);
+        cout << setw(16) << label.str() << fixed << setprecision(1)
+             << setw(12) << byKey.perOp << setw(12) << byKey.perRemove
+             << setw(16) << byBegin.perRemove << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// A uint64_t that is not an arithmetic type, so that trees keyed on it
+// take the general BstKeyTraits path.
+struct BoxedKey
+{
+    uint64_t v;
+    bool operator==(const BoxedKey& rhs) const { return v == rhs.v; }
+    bool operator!=(const BoxedKey& rhs) const { return v != rhs.v; }
+    bool operator<(const BoxedKey& rhs) const { return v < rhs.v; }
+    bool operator>(const BoxedKey& rhs) const { return rhs.v < v; }
+};
+
+// Needed by the tree's print()
+ostream& operator<<(ostream& out, const BoxedKey& key)
+{
+    return out << key.v;
+}
+
+template<typename Key>
+Key makeKey(uint64_t v) { return Key(v); }
+
+template<>
+BoxedKey makeKey<BoxedKey>(uint64_t v) { BoxedKey key = { v }; return key; }
+
+// Times random lookups of present keys in an AVLTree<Key, uint32_t>.
+template<typename Key>
+double timeKeyLookups(const vector<uint64_t>& values, const vector<uint64_t>& probes)
+{
+    AVLTree<Key, uint32_t> tree;
+    for (size_t i = 0; i < values.size(); ++i) {
+        tree.insert(make_pair(makeKey<Key>(values[i]), (uint32_t)i));
+    }
+    long sum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        sum += tree.find(makeKey<Key>(probes[i]))->second;
+    }
+    double elapsed = secondsSince(start);
+    benchSink = sum;
+    return elapsed * 1e9 / probes.size();
+}
+
+// The arithmetic-key descent against the general one, on random
+// uint64_t keys.
+void benchKeys(size_t n)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> values(n);
+    for (size_t i = 0; i < n; ++i) values[i] = rng();
+    vector<uint64_t> probes(n);
+    for (size_t i = 0; i < n; ++i) probes[i] = values[rng() % n];
+
+    cout << "Random lookups on " << n << " uint64_t -> uint32_t keys (ns per find)" << endl;
+    cout << setw(16) << "key type" << setw(12) << "AVLTree" << endl;
+    cout << fixed << setprecision(1);
+    cout << setw(16) << "uint64_t" << setw(12) << timeKeyLookups<uint64_t>(values, probes) << endl;
+    cout << setw(16) << "boxed" << setw(12) << timeKeyLookups<BoxedKey>(values, probes) << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// Times finds of every probe in a fresh tree holding keys.
+template<typename Tree>
+double timeFinds(const vector<int>& keys, const vector<int>& probes)
+{
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(make_pair(keys[i], keys[i]));
+    }
+    return timeLookups(tree, probes);
+}
+
+// Finds in ascending key order, where every left/right choice in the
+// descent is predictable, against finds in random order, where about half
+// of them are mispredicted.
+void benchRandom(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<int> ascending(n);
+    for (size_t i = 0; i < n; ++i) ascending[i] = (int)i;
+    vector<int> random = keys;
+    shuffle(random.begin(), random.end(), rng);
+
+    cout << "Finds of " << n << " int keys (ns per find)" << endl;
+    cout << setw(16) << "tree" << setw(12) << "ascending" << setw(12) << "random" << endl;
+    cout << fixed << setprecision(1);
+    cout << setw(16) << "AVLTree"
+         << setw(12) << timeFinds<AVLTree<int, int> >(keys, ascending)
+         << setw(12) << timeFinds<AVLTree<int, int> >(keys, random) << endl;
+    cout << setw(16) << "RedBlackTree"
+         << setw(12) << timeFinds<RedBlackTree<int, int> >(keys, ascending)
+         << setw(12) << timeFinds<RedBlackTree<int, int> >(keys, random) << endl;
+    cout << setw(16) << "ScapegoatTree"
+         << setw(12) << timeFinds<ScapegoatTree<int, int> >(keys, ascending)
+         << setw(12) << timeFinds<ScapegoatTree<int, int> >(keys, random) << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// A pointer and length into a request buffer, standing in for
+// std::string_view (which needs C++17). Compares with std::string keys
+// without copying and, unlike a const char*, without a strlen per compare.
+struct KeyView
+{
+    const char* data;
+    size_t size;
+};
+
+bool operator<(const KeyView& lhs, const string& rhs) { return rhs.compare(0, string::npos, lhs.data, lhs.size) > 0; }
+bool operator<(const string& lhs, const KeyView& rhs) { return lhs.compare(0, string::npos, rhs.data, rhs.size) < 0; }
+
+// Times one heterogeneous find per probe in a string-keyed tree.
+template<typename Probe>
+double timeStringFinds(const AVLTree<string, int>& tree, const vector<Probe>& probes)
+{
+    long sum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        sum += tree.find(probes[i])->second;
+    }
+    double elapsed = secondsSince(start);
+    benchSink = sum;
+    return elapsed * 1e9 / probes.size();
+}
+
+// String keys looked up from request-buffer bytes: through a temporary
+// std::string per lookup, and through the heterogeneous find() with a
+// const char* and with a pointer and length. Keys are long enough to
+// defeat the small string optimization, so each temporary allocates.
+void benchStrings(size_t n)
+{
+    vector<string> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        ostringstream key;
+        key << "/api/v1/routes/" << setw(10) << setfill('0') << i;
+        keys[i] = key.str();
+    }
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    AVLTree<string, int> tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], (int)i));
+    }
+    vector<const char*> cstrings(n);
+    vector<KeyView> views(n);
+    for (size_t i = 0; i < n; ++i) {
+        const string& key = keys[rng() % n];
+        cstrings[i] = key.c_str();
+        KeyView view = { key.data(), key.size() };
+        views[i] = view;
+    }
+
+    long sum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += tree.find(string(cstrings[i]))->second;
+    }
+    double temporaryTime = secondsSince(start) * 1e9 / n;
+    benchSink = sum;
+
+    cout << "Lookups of " << n << " string keys (ns per find)" << endl;
+    cout << setw(16) << "key passed as" << setw(12) << "AVLTree" << endl;
+    cout << fixed << setprecision(1);
+    cout << setw(16) << "std::string" << setw(12) << temporaryTime << endl;
+    cout << setw(16) << "const char*" << setw(12) << timeStringFinds(tree, cstrings) << endl;
+    cout << setw(16) << "pointer, length" << setw(12) << timeStringFinds(tree, views) << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// Range sums over random key intervals of several widths: aggregate(lo,
+// hi) on cached subtree sums against iterating the range.
+void benchRanges(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    AugmentedAVLTree<int, long, SumMonoid<long> > tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], (long)keys[i]));
+    }
+
+    cout << "Range sums over " << n << " int keys (ns per query)" << endl;
+    cout << setw(16) << "range width" << setw(12) << "aggregate" << setw(12) << "iterate" << endl;
+    const size_t widths[] = { 10, 1000, 100000 };
+    const size_t queries = 1000;
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        if (widths[w] > n) {
+            break;
+        }
+        vector<int> starts(queries);
+        for (size_t i = 0; i < queries; ++i) starts[i] = (int)(rng() % (n - widths[w] + 1));
+
+        long sum = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < queries; ++i) {
+            sum += tree.aggregate(starts[i], starts[i] + (int)widths[w] - 1);
+        }
+        double aggregateTime = secondsSince(start);
+
+        start = Clock::now();
+        for (size_t i = 0; i < queries; ++i) {
+            int hi = starts[i] + (int)widths[w] - 1;
+            typedef AugmentedAVLTree<int, long, SumMonoid<long> >::iterator Iterator;
+            for (Iterator it = tree.lower_bound(starts[i]); it != tree.end() && it->first <= hi; ++it) {
+                sum -= it->second;
+            }
+        }
+        double iterateTime = secondsSince(start);
+        benchSink = sum;
+
+        cout << setw(16) << widths[w] << fixed << setprecision(1)
+             << setw(12) << aggregateTime * 1e9 / queries
+             << setw(12) << iterateTime * 1e9 / queries << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// Counts the intervals reported by IntervalTree::overlapping().
+struct OverlapCounter
+{
+    size_t* count;
+    void operator()(const pair<const Interval<int>, int>&) const { ++*count; }
+};
+
+// Overlap queries on n intervals with random starts and lengths up to
+// 1000 (in units where starts average 10 apart): IntervalTree against
+// the full scan of an AVLTree keyed by start that it replaces. The scan
+// is timed on a few queries only, since each one visits every interval.
+void benchIntervals(size_t n)
+{
+    mt19937 rng(104);
+    int span = (int)min<size_t>(n * 10, numeric_limits<int>::max() - 1000);
+    IntervalTree<int, int> intervals;
+    AVLTree<int, int> byStart;
+    for (size_t i = 0; i < n; ++i) {
+        int start = (int)(rng() % span);
+        int end = start + (int)(rng() % 1000);
+        intervals.insert(make_pair(Interval<int>(start, end), (int)i));
+        byStart.insert(make_pair(start, end));
+    }
+
+    cout << "Overlap queries on " << n << " intervals (ns per query)" << endl;
+    cout << setw(16) << "query width" << setw(12) << "reported" << setw(14) << "IntervalTree"
+         << setw(14) << "AVL scan" << endl;
+    const int widths[] = { 0, 100, 10000 };
+    const size_t queries = 1000;
+    const size_t scans = 3;
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        vector<int> starts(queries);
+        for (size_t i = 0; i < queries; ++i) starts[i] = (int)(rng() % span);
+
+        size_t reported = 0;
+        OverlapCounter counter = { &reported };
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < queries; ++i) {
+            intervals.overlapping(starts[i], starts[i] + widths[w], counter);
+        }
+        double treeTime = secondsSince(start);
+
+        size_t scanned = 0;
+        start = Clock::now();
+        for (size_t i = 0; i < scans; ++i) {
+            int hi = starts[i] + widths[w];
+            for (AVLTree<int, int>::iterator it = byStart.begin(); it != byStart.end(); ++it) {
+                if (it->first <= hi && it->second >= starts[i]) {
+                    ++scanned;
+                }
+            }
+        }
+        double scanTime = secondsSince(start);
+        benchSink = (long)scanned;
+
+        cout << setw(16) << widths[w] << fixed << setprecision(1)
+             << setw(12) << (double)reported / queries
+             << setw(14) << treeTime * 1e9 / queries
+             << setw(14) << scanTime * 1e9 / scans << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+typedef AVLTree<int, string> Shard;
+
+// Fills a shard with keys[0, n) and 64-byte string values, which are
+// heap-allocated so that copying one costs an allocation.
+void fillShard(Shard& shard, const vector<int>& keys)
+{
+    for (size_t i = 0; i < keys.size(); ++i) {
+        shard.insert(make_pair(keys[i], string(64, (char)('a' + i % 26))));
+    }
+}
+
+// Moving every entry of one AVLTree shard to another: remove plus insert
+// (a free, an allocation and a value copy per entry), extract plus
+// insert of the node handle, and merge(). The two shards hold
+// interleaved keys, so every move lands inside the target. Each method
+// runs three times in rotating order, keeping the best: a run inherits
+// the heap its predecessors left, which otherwise favours whichever
+// method runs first.
+double timeHandles(int method, const vector<int>& evens, const vector<int>& odds)
+{
+    size_t n = odds.size();
+    Shard source, target;
+    fillShard(source, odds);
+    fillShard(target, evens);
+    Clock::time_point start = Clock::now();
+    if (method == 0) {
+        for (size_t i = 0; i < n; ++i) {
+            pair<const int, string> item = *source.find(odds[i]);
+            source.remove(odds[i]);
+            target.insert(item);
+        }
+    }
+    else if (method == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            target.insert(source.extract(odds[i]));
+        }
+    }
+    else {
+        target.merge(source);
+    }
+    double seconds = secondsSince(start);
+    benchSink = (long)target.size();
+    return seconds;
+}
+
+void benchHandles(size_t n)
+{
+    vector<int> evens(n), odds(n);
+    for (size_t i = 0; i < n; ++i) {
+        evens[i] = (int)(2 * i);
+        odds[i] = (int)(2 * i + 1);
+    }
+    mt19937 rng(104);
+    shuffle(evens.begin(), evens.end(), rng);
+    shuffle(odds.begin(), odds.end(), rng);
+
+    double best[3] = { 0, 0, 0 };
+    for (int run = 0; run < 3; ++run) {
+        for (int i = 0; i < 3; ++i) {
+            int method = (run + i) % 3;
+            double seconds = timeHandles(method, evens, odds);
+            if (run == 0 || seconds < best[method]) {
+                best[method] = seconds;
+            }
+        }
+    }
+
+    cout << "Moving " << n << " entries between AVLTree<int, string> shards (ns per entry)" << endl;
+    cout << setw(16) << "method" << setw(12) << "ns/entry" << endl;
+    const char* names[] = { "remove+insert", "extract+insert", "merge" };
+    for (int method = 0; method < 3; ++method) {
+        cout << setw(16) << names[method] << fixed << setprecision(1)
+             << setw(12) << best[method] * 1e9 / n << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// Copying an n-key AVLTree: the structural clone of the copy
+// constructor against rebuilding by inserting every item in key order,
+// with and without a hint, and a move for scale.
+void benchCopy(size_t n)
+{
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    AVLTree<int, int> baseline;
+    for (size_t i = 0; i < n; ++i) {
+        baseline.insert(make_pair(keys[i], (int)i));
+    }
+
+    cout << "Copying an AVLTree of " << n << " int keys (ms per copy)" << endl;
+    cout << setw(16) << "method" << setw(12) << "ms" << endl;
+    for (int method = 0; method < 4; ++method) {
+        Clock::time_point start = Clock::now();
+        AVLTree<int, int> copy;
+        if (method == 0) {
+            AVLTree<int, int> clone(baseline);
+            copy = std::move(clone);
+        }
+        else if (method == 1) {
+            for (AVLTree<int, int>::iterator it = baseline.begin(); it != baseline.end(); ++it) {
+                copy.insert(*it);
+            }
+        }
+        else if (method == 2) {
+            AVLTree<int, int>::iterator hint = copy.end();
+            for (AVLTree<int, int>::iterator it = baseline.begin(); it != baseline.end(); ++it) {
+                hint = copy.insert(hint, *it);
+            }
+        }
+        else {
+            AVLTree<int, int> moved(std::move(baseline));
+            baseline = std::move(moved);
+        }
+        double seconds = secondsSince(start);
+        benchSink = (long)copy.size();
+        const char* names[] = { "clone", "insert", "hinted insert", "move" };
+        cout << setw(16) << names[method] << fixed << setprecision(3)
+             << setw(12) << seconds * 1e3 << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// An AVLTree as a timer queue holding n deadlines: each tick pops the
+// earliest and schedules a new one up to n ticks later. popMin() against
+// removing front()'s key, which searches for it again, and the cost of
+// begin() alone.
+void benchQueue(size_t n)
+{
+    const size_t ticks = 1000000;
+    cout << "AVLTree timer queue of " << n << " deadlines (ns per tick)" << endl;
+    cout << setw(16) << "method" << setw(12) << "ns/tick" << endl;
+    for (int method = 0; method < 3; ++method) {
+        AVLTree<long, int> timers;
+        mt19937 rng(104);
+        for (size_t i = 0; i < n; ++i) {
+            timers.insert(make_pair((long)(rng() % n) * (long)n + (long)i, 0));
+        }
+        long now = 0;
+        long sum = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t t = 0; t < ticks; ++t) {
+            if (method == 0) {
+                now = timers.popMin().key();
+            }
+            else if (method == 1) {
+                now = timers.front().first;
+                timers.remove(now);
+            }
+            else {
+                sum += timers.begin()->first;
+                continue;
+            }
+            timers.insert(make_pair(now + (long)(rng() % n + 1) * (long)n, (int)t));
+        }
+        double seconds = secondsSince(start);
+        benchSink = sum + now;
+        const char* names[] = { "popMin", "remove(front)", "begin only" };
+        cout << setw(16) << names[method] << fixed << setprecision(1)
+             << setw(12) << seconds * 1e9 / ticks << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// Lookups in an AVLTree, in a sorted array with binary search and in a
+// VebSnapshot of the tree, for sizes from 1K keys growing eightfold up to
+// n. Half of the probes miss.
+void benchVeb(size_t n)
+{
+    const size_t lookups = 1000000;
+    cout << "Read-only lookups (ns per lookup)" << endl;
+    cout << setw(12) << "keys" << setw(12) << "AVL find" << setw(12) << "sorted lb"
+         << setw(12) << "vEB find" << setw(12) << "vEB lb" << setw(12) << "vEB bytes" << endl;
+    vector<size_t> sizes;
+    for (size_t size = 1024; size <= n; size *= 8) {
+        sizes.push_back(size);
+    }
+    if (sizes.empty() || sizes.back() != n) {
+        sizes.push_back(n);
+    }
+    for (size_t s = 0; s < sizes.size(); ++s) {
+        size_t size = sizes[s];
+        vector<long> keys(size);
+        for (size_t i = 0; i < size; ++i) keys[i] = 2 * (long)i;
+        mt19937 rng(104);
+        shuffle(keys.begin(), keys.end(), rng);
+        AVLTree<long, long> tree;
+        for (size_t i = 0; i < size; ++i) {
+            tree.insert(make_pair(keys[i], keys[i]));
+        }
+        VebSnapshot<long, long> snapshot(tree);
+        sort(keys.begin(), keys.end());
+        vector<long> probes(lookups);
+        for (size_t i = 0; i < lookups; ++i) probes[i] = (long)(rng() % (2 * size));
+
+        double times[4];
+        long sum = 0;
+        for (int method = 0; method < 4; ++method) {
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < lookups; ++i) {
+                if (method == 0) {
+                    sum += tree.find(probes[i]) != tree.end();
+                }
+                else if (method == 1) {
+                    sum += lower_bound(keys.begin(), keys.end(), probes[i]) != keys.end();
+                }
+                else if (method == 2) {
+                    sum += snapshot.find(probes[i]) != snapshot.end();
+                }
+                else {
+                    sum += snapshot.lower_bound(probes[i]) != snapshot.end();
+                }
+            }
+            times[method] = secondsSince(start);
+        }
+        benchSink = sum;
+        cout << setw(12) << size << fixed << setprecision(1);
+        for (int method = 0; method < 4; ++method) {
+            cout << setw(12) << times[method] * 1e9 / lookups;
+        }
+        cout << setw(12) << snapshot.bytesUsed() << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+// A corpus of n distinct URLs: a few hosts, paths of two to six segments
+// drawn from a small vocabulary or numeric ids, and some file names, so
+// that keys share long prefixes as crawled or logged URLs do.
+vector<string> makeUrls(size_t n, mt19937& rng)
+{
+    const char* hosts[] = { "https://www.example.com", "https://shop.example.com", "https://api.example.org",
+                            "https://static.example.net", "http://blog.example.io" };
+    const char* segments[] = { "api", "v1", "v2", "users", "orders", "items", "products", "catalog", "search",
+                               "static", "images", "account", "settings", "reviews", "categories", "2023", "2024" };
+    const char* files[] = { "index.html", "thumb.jpg", "style.css", "app.js", "feed.xml" };
+    const size_t numHosts = sizeof(hosts) / sizeof(hosts[0]);
+    const size_t numSegments = sizeof(segments) / sizeof(segments[0]);
+    const size_t numFiles = sizeof(files) / sizeof(files[0]);
+    vector<string> urls;
+    urls.reserve(n + n / 8);
+    while (urls.size() < n) {
+        while (urls.size() < n + n / 8) {
+            string url = hosts[rng() % numHosts];
+            size_t depth = 2 + rng() % 5;
+            for (size_t d = 0; d < depth; ++d) {
+                url += '/';
+                if (rng() % 3 == 0) {
+                    url += to_string(rng() % (n + 1000));
+                }
+                else {
+                    url += segments[rng() % numSegments];
+                }
+            }
+            if (rng() % 4 == 0) {
+                url += '/';
+                url += files[rng() % numFiles];
+            }
+            urls.push_back(url);
+        }
+        sort(urls.begin(), urls.end());
+        urls.erase(unique(urls.begin(), urls.end()), urls.end());
+    }
+    shuffle(urls.begin(), urls.end(), rng);
+    urls.resize(n);
+    return urls;
+}
+
+// Bytes a string holds on the heap, beyond its inline buffer.
+size_t heapBytes(const string& s)
+{
+    static const size_t inlineCapacity = string().capacity();
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+// Inserts every URL, finds every URL (in another order), finds as many
+// missing URLs and looks up the lower bound of as many, timing each
+// phase.
+template<typename Tree>
+void runUrls(const char* name, Tree& tree, const vector<string>& urls, const vector<string>& probes,
+             const vector<string>& misses, size_t (*bytes)(const Tree&, const vector<string>&))
+{
+    size_t n = urls.size();
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(urls[i], (int)i));
+    }
+    double insertTime = secondsSince(start);
+
+    long sum = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += (*tree.find(probes[i])).second;
+    }
+    double findTime = secondsSince(start);
+    start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += tree.find(misses[i]) == tree.end();
+    }
+    double missTime = secondsSince(start);
+    start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += tree.lower_bound(misses[i]) == tree.end();
+    }
+    double boundTime = secondsSince(start);
+    benchSink = sum;
+
+    cout << setw(16) << name << fixed << setprecision(1)
+         << setw(12) << insertTime * 1e9 / n << setw(12) << findTime * 1e9 / n
+         << setw(12) << missTime * 1e9 / n << setw(12) << boundTime * 1e9 / n
+         << setw(12) << (double)bytes(tree, urls) / n << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// Node bytes as the trees report them, plus the keys' heap buffers. For
+// std::map the node is estimated as the item plus libstdc++'s 32-byte
+// red-black header. Allocator overhead is left out throughout.
+size_t urlBytes(const AVLTree<string, int>& tree, const vector<string>& urls)
+{
+    size_t bytes = tree.stats().bytesUsed;
+    for (size_t i = 0; i < urls.size(); ++i) bytes += heapBytes(urls[i]);
+    return bytes;
+}
+
+size_t urlBytes(const map<string, int>& tree, const vector<string>& urls)
+{
+    size_t bytes = tree.size() * (sizeof(pair<const string, int>) + 32);
+    for (size_t i = 0; i < urls.size(); ++i) bytes += heapBytes(urls[i]);
+    return bytes;
+}
+
+size_t urlBytes(const RadixTree<int>& tree, const vector<string>&)
+{
+    return tree.bytesUsed();
+}
+
+// String-keyed maps on a generated URL corpus: AVLTree and std::map
+// store each URL in full, RadixTree stores shared prefixes once.
+void benchUrls(size_t n)
+{
+    mt19937 rng(104);
+    vector<string> urls = makeUrls(n, rng);
+    vector<string> probes(urls);
+    shuffle(probes.begin(), probes.end(), rng);
+    // Misses differ from a stored URL in their last byte, so they share
+    // its whole prefix
+    vector<string> misses(probes);
+    size_t length = 0;
+    for (size_t i = 0; i < n; ++i) {
+        misses[i] += '~';
+        length += urls[i].size();
+    }
+
+    cout << n << " URLs, " << length / n << " bytes on average (ns per operation)" << endl;
+    cout << setw(16) << "tree" << setw(12) << "insert" << setw(12) << "find"
+         << setw(12) << "find miss" << setw(12) << "lower_bound" << setw(12) << "bytes/key" << endl;
+    {
+        AVLTree<string, int> tree;
+        runUrls("AVLTree", tree, urls, probes, misses, urlBytes);
+    }
+    {
+        map<string, int> tree;
+        runUrls("std::map", tree, urls, probes, misses, urlBytes);
+    }
+    {
+        RadixTree<int> tree;
+        runUrls("RadixTree", tree, urls, probes, misses, urlBytes);
+        cout << "RadixTree nodes per key: " << fixed << setprecision(2) << (double)tree.nodeCount() / n << endl;
+        cout.unsetf(ios::fixed);
+    }
+}
+
+struct Section
+{
+    const char* name;
+    void (*run)(size_t n);
+};
+
+const Section sections[] = {
+    { "modes", benchModes },
+    { "splay", benchSplay },
+    { "writes", benchWrites },
+    { "scapegoat", benchScapegoat },
+    { "hotkeys", benchHotKeys },
+    { "hinted", benchHinted },
+    { "lazy", benchLazy },
+    { "keys", benchKeys },
+    { "random", benchRandom },
+    { "strings", benchStrings },
+    { "ranges", benchRanges },
+    { "intervals", benchIntervals },
+    { "handles", benchHandles },
+    { "copy", benchCopy },
+    { "queue", benchQueue },
+    { "veb", benchVeb },
+    { "urls", benchUrls },
+};
+
+int main(int argc, char* argv[])
+{
+    size_t n = 1000000;
+    vector<const Section*> selected;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = strtoul(argv[++i], nullptr, 10);
+            continue;
+        }
+        bool found = false;
+        for (size_t s = 0; s < sizeof(sections) / sizeof(sections[0]); ++s) {
+            if (strcmp(argv[i], sections[s].name) == 0) {
+                selected.push_back(&sections[s]);
+                found = true;
+            }
+        }
+        if (!found) {
+            cerr << "Unknown section " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if (selected.empty()) {
+        for (size_t s = 0; s < sizeof(sections) / sizeof(sections[0]); ++s) {
+            selected.push_back(&sections[s]);
+        }
+    }
+    for (size_t s = 0; s < selected.size(); ++s) {
+        if (s > 0) cout << endl;
+        selected[s]->run(n);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include "bst.h"
+#include "avlbst.h"
+#include "bst-coro.h"
+
+using namespace std;
+
+// Benchmark for InterleavedFinder: lookups per second against group size
+// on an AVLTree far larger than the last-level cache.
+// Usage: ./bst-coro-bench [-n keys] [-q lookups]
+// Keys default to 16000000 (about 1 GB of nodes), lookups to 2000000.
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the optimizer from dropping lookups whose results are unused.
+volatile long benchSink;
+
+int main(int argc, char* argv[])
+{
+    size_t n = 16000000;
+    size_t lookups = 2000000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            lookups = strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [-n keys] [-q lookups]" << endl;
+            return 1;
+        }
+    }
+
+    // Even keys in random order, so that nodes are scattered in memory
+    // and half the probes (the odd ones) miss
+    vector<long> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = 2 * (long)i;
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    AVLTree<long, long> tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(keys[i], keys[i]));
+    }
+    vector<long> probes(lookups);
+    for (size_t i = 0; i < lookups; ++i) probes[i] = (long)(rng() % (2 * n));
+
+    typedef AVLTree<long, long>::iterator Iterator;
+    vector<Iterator> expected(lookups);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        expected[i] = tree.find(probes[i]);
+    }
+    double findTime = secondsSince(start);
+
+    cout << "Batched lookups on an AVLTree of " << n << " long keys, "
+         << tree.stats().bytesUsed / (1 << 20) << " MiB of nodes, height " << tree.height() << endl;
+    cout << setw(12) << "group" << setw(14) << "Mlookups/s" << setw(12) << "ns/lookup" << endl;
+    cout << fixed << setprecision(2);
+    cout << setw(12) << "find()" << setw(14) << lookups / findTime / 1e6
+         << setw(12) << findTime * 1e9 / lookups << endl;
+
+    // Batches of a few thousand keys, as a caller streaming requests would
+    const size_t batch = 4096;
+    const size_t groups[] = { 1, 2, 4, 8, 12, 16, 24, 32, 48, 64 };
+    vector<Iterator> results(lookups);
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); ++g) {
+        InterleavedFinder<long, long> finder(tree, groups[g]);
+        start = Clock::now();
+        for (size_t i = 0; i < lookups; i += batch) {
+            finder.find(&probes[i], min(batch, lookups - i), &results[i]);
+        }
+        double seconds = secondsSince(start);
+        if (!equal(results.begin(), results.end(), expected.begin())) {
+            cerr << "Group " << groups[g] << " results differ from find()" << endl;
+            return 1;
+        }
+        cout << setw(12) << groups[g] << setw(14) << lookups / seconds / 1e6
+             << setw(12) << seconds * 1e9 / lookups << endl;
+    }
+    long found = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        found += (results[i] != tree.end());
+    }
+    benchSink = found;
+    return 0;
+}
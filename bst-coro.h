@@ -0,0 +1,171 @@
+#ifndef BST_CORO_H
+#define BST_CORO_H
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <cstddef>
+#include "bst.h"
+
+#if __cplusplus < 202002L
+#error "bst-coro.h needs C++20 coroutines (compile with -std=c++20)"
+#endif
+
+/**
+* Looks up a batch of keys in a BinarySearchTree (or any tree derived from
+* it) with up to groupSize descents in flight on one thread.
+*
+* In a tree much larger than the cache, each step of a find() waits on a
+* cache miss for the next node, and since the step after depends on it
+* nothing else can happen meanwhile. Here each descent is a coroutine that
+* prefetches the node it is about to read and then suspends; the scheduler
+* resumes the other descents in turn, so by the time it comes back the
+* node has usually arrived and groupSize misses overlap instead of queuing.
+* Each coroutine serves many keys, so a batch allocates groupSize frames,
+* not one per key.
+*
+* Results match find(), except that the lookup cache is neither read nor
+* filled. The tree must not be modified during a batch.
+*/
+template <typename Key, typename Value>
+class InterleavedFinder
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    InterleavedFinder(const BinarySearchTree<Key, Value>& tree, size_t groupSize);
+
+    void find(const Key* keys, size_t count, iterator* results);
+
+protected:
+    /**
+    * The coroutine type of a descent worker. Workers start suspended and
+    * stay suspended at the end, so that the scheduler can test done()
+    * before destroying them.
+    */
+    struct Worker
+    {
+        struct promise_type
+        {
+            Worker get_return_object() { return Worker(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+            std::suspend_always final_suspend() noexcept { return std::suspend_always(); }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        explicit Worker(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Worker descend();
+    static void prefetch(const Node<Key, Value>* node);
+
+    const BinarySearchTree<Key, Value>& tree_;
+    size_t groupSize_;
+
+    // The batch in progress; next_ is the index of the next unclaimed key
+    const Key* keys_;
+    size_t count_;
+    size_t next_;
+    iterator* results_;
+};
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the InterleavedFinder class.
+  ------------------------------------------------------
+*/
+
+/**
+* A finder over tree running groupSize descents at once. A group of 1
+* runs the lookups one after another, as a loop of find() calls does.
+*/
+template<typename Key, typename Value>
+InterleavedFinder<Key, Value>::InterleavedFinder(const BinarySearchTree<Key, Value>& tree, size_t groupSize) :
+    tree_(tree), groupSize_(groupSize > 0 ? groupSize : 1),
+    keys_(nullptr), count_(0), next_(0), results_(nullptr)
+{
+
+}
+
+/**
+* Sets results[i] to find(keys[i]) for every i below count. Workers are
+* resumed round robin, each for one step of its current descent, until
+* every key has been claimed and every worker has finished.
+*/
+template<typename Key, typename Value>
+void InterleavedFinder<Key, Value>::find(const Key* keys, size_t count, iterator* results)
+{
+    BST_PERF_SCOPE(OP_FIND);
+    keys_ = keys;
+    count_ = count;
+    next_ = 0;
+    results_ = results;
+
+    std::vector<std::coroutine_handle<typename Worker::promise_type> > workers;
+    size_t groupSize = groupSize_ < count ? groupSize_ : count;
+    for (size_t i = 0; i < groupSize; ++i) {
+        workers.push_back(descend().handle);
+    }
+    size_t running = workers.size();
+    while (running > 0) {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (!workers[i].done()) {
+                workers[i].resume();
+                if (workers[i].done()) {
+                    --running;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].destroy();
+    }
+}
+
+/**
+* A worker: claims keys until none are left, and descends for each one
+* as BstKeyTraits::descend does, suspending once per node between the
+* prefetch of the node and the first read of it.
+*/
+template<typename Key, typename Value>
+typename InterleavedFinder<Key, Value>::Worker InterleavedFinder<Key, Value>::descend()
+{
+    while (next_ < count_) {
+        size_t index = next_++;
+        const Key& key = keys_[index];
+        Node<Key, Value>* node = tree_.root_;
+        while (node != nullptr) {
+            prefetch(node);
+            co_await std::suspend_always();
+            BST_PERF_COUNT(SW_NODES_VISITED);
+            if (key == node->getKey()) {
+                break;
+            }
+            node = node->getChild(node->getKey() < key);
+        }
+        results_[index] = iterator(tree_.isLive(node) ? node : nullptr);
+    }
+}
+
+/**
+* Prefetches the first and last byte of the Node part of node (the key
+* and the child pointers), which may straddle two cache lines.
+*/
+template<typename Key, typename Value>
+void InterleavedFinder<Key, Value>::prefetch(const Node<Key, Value>* node)
+{
+    const char* bytes = reinterpret_cast<const char*>(node);
+    __builtin_prefetch(bytes);
+    __builtin_prefetch(bytes + sizeof(Node<Key, Value>) - 1);
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the InterleavedFinder class.
+  ----------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef BST_PERF_H
+#define BST_PERF_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Opt-in instrumentation for the search trees in bst.h and avlbst.h.
+ *
+ * Nothing in this file is used unless the trees are compiled with
+ * -DBST_PERF (see DEFS in the Makefile). When enabled, every insert, remove,
+ * internalFind and iterator increment is wrapped in a Scope that reads the
+ * hardware counters (cycles, instructions, cache misses, branch misses)
+ * through perf_event_open before and after the operation, and the trees
+ * bump software counters for the nodes they visit, the rotations they do
+ * and the nodeSwap calls they make.
+ *
+ * Only the outermost operation is measured, so e.g. the splay and the base
+ * find done inside SplayTree::find count as one find, and the lookup done
+ * inside BinarySearchTree::remove is charged to the remove. The counters
+ * only count user space, so the read() calls themselves add very little
+ * noise.
+ * All state is per thread. If perf_event_open is unavailable (no kernel
+ * support, or perf_event_paranoid forbids it) the hardware columns are
+ * reported as n/a and the software counters still work.
+ */
+namespace bstperf {
+
+enum Operation { OP_INSERT, OP_REMOVE, OP_FIND, OP_ITERATE, NUM_OPERATIONS };
+enum HardwareCounter { HW_CYCLES, HW_INSTRUCTIONS, HW_CACHE_MISSES, HW_BRANCH_MISSES, NUM_HW_COUNTERS };
+enum SoftwareCounter { SW_NODES_VISITED, SW_ROTATIONS, SW_NODE_SWAPS, NUM_SW_COUNTERS };
+
+/**
+ * Accumulated totals for one kind of operation.
+ */
+struct OperationStats
+{
+    uint64_t calls;
+    uint64_t hw[NUM_HW_COUNTERS];
+    uint64_t sw[NUM_SW_COUNTERS];
+};
+
+/**
+ * Owns one perf_event_open group (leader = cycles) for the calling thread.
+ */
+class HardwareCounters
+{
+public:
+    HardwareCounters() : available_(false)
+    {
+        for(int i = 0; i < NUM_HW_COUNTERS; ++i) fds_[i] = -1;
+#ifdef __linux__
+        static const uint64_t configs[NUM_HW_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for(int i = 0; i < NUM_HW_COUNTERS; ++i) {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = (i == 0);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds_[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0);
+            if(fds_[i] < 0) {
+                close();
+                return;
+            }
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        available_ = true;
+#endif
+    }
+
+    ~HardwareCounters()
+    {
+        close();
+    }
+
+    bool available() const
+    {
+        return available_;
+    }
+
+    /**
+     * Reads all counters of the group with one syscall.
+     * Leaves values untouched if the counters are unavailable.
+     */
+    void read(uint64_t values[NUM_HW_COUNTERS]) const
+    {
+#ifdef __linux__
+        if(!available_) return;
+        uint64_t buf[1 + NUM_HW_COUNTERS];
+        if(::read(fds_[0], buf, sizeof(buf)) == (ssize_t)sizeof(buf)) {
+            for(int i = 0; i < NUM_HW_COUNTERS; ++i) values[i] = buf[1 + i];
+        }
+#endif
+    }
+
+private:
+    void close()
+    {
+#ifdef __linux__
+        for(int i = NUM_HW_COUNTERS - 1; i >= 0; --i) {
+            if(fds_[i] >= 0) ::close(fds_[i]);
+            fds_[i] = -1;
+        }
+#endif
+        available_ = false;
+    }
+
+    int fds_[NUM_HW_COUNTERS];
+    bool available_;
+};
+
+/**
+ * Per-thread instrumentation state.
+ */
+struct State
+{
+    State() : depth(0), current(OP_FIND)
+    {
+        std::memset(stats, 0, sizeof(stats));
+    }
+
+    HardwareCounters counters;
+    OperationStats stats[NUM_OPERATIONS];
+    int depth;
+    Operation current;
+};
+
+inline State& state()
+{
+    static thread_local State s;
+    return s;
+}
+
+/**
+ * Charges one software event to the operation currently being measured.
+ * Events outside of any measured operation are dropped.
+ */
+inline void count(SoftwareCounter counter, uint64_t n = 1)
+{
+    State& s = state();
+    if(s.depth > 0) s.stats[s.current].sw[counter] += n;
+}
+
+/**
+ * RAII guard that measures the hardware counters across one operation.
+ */
+class Scope
+{
+public:
+    explicit Scope(Operation op) : state_(state()), outermost_(state_.depth++ == 0)
+    {
+        if(!outermost_) return;
+        state_.current = op;
+        std::memset(start_, 0, sizeof(start_));
+        state_.counters.read(start_);
+    }
+
+    ~Scope()
+    {
+        --state_.depth;
+        if(!outermost_) return;
+        uint64_t end[NUM_HW_COUNTERS];
+        std::memcpy(end, start_, sizeof(end));
+        state_.counters.read(end);
+        OperationStats& stats = state_.stats[state_.current];
+        ++stats.calls;
+        for(int i = 0; i < NUM_HW_COUNTERS; ++i) stats.hw[i] += end[i] - start_[i];
+    }
+
+private:
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+
+    State& state_;
+    bool outermost_;
+    uint64_t start_[NUM_HW_COUNTERS];
+};
+
+/**
+ * Returns the totals gathered so far on this thread for one operation.
+ */
+inline const OperationStats& stats(Operation op)
+{
+    return state().stats[op];
+}
+
+/**
+ * Clears all totals gathered so far on this thread.
+ */
+inline void reset()
+{
+    State& s = state();
+    std::memset(s.stats, 0, sizeof(s.stats));
+}
+
+/**
+ * Prints per-operation averages for this thread.
+ */
+inline void report(std::ostream& os)
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    static const char* opNames[NUM_OPERATIONS] = { "insert", "remove", "find", "iterate" };
+    static const char* hwNames[NUM_HW_COUNTERS] = { "cycles", "instr", "cache-miss", "branch-miss" };
+    static const char* swNames[NUM_SW_COUNTERS] = { "visited", "rotations", "swaps" };
+    bool hw = state().counters.available();
+
+    os << std::setw(10) << "op" << std::setw(12) << "calls";
+    for(int i = 0; i < NUM_HW_COUNTERS; ++i) os << std::setw(13) << hwNames[i];
+    for(int i = 0; i < NUM_SW_COUNTERS; ++i) os << std::setw(11) << swNames[i];
+    os << "\n";
+    for(int op = 0; op < NUM_OPERATIONS; ++op) {
+        const OperationStats& s = stats((Operation)op);
+        double calls = s.calls == 0 ? 1.0 : (double)s.calls;
+        os << std::setw(10) << opNames[op] << std::setw(12) << s.calls << std::fixed << std::setprecision(2);
+        for(int i = 0; i < NUM_HW_COUNTERS; ++i) {
+            if(hw) os << std::setw(13) << s.hw[i] / calls;
+            else os << std::setw(13) << "n/a";
+        }
+        for(int i = 0; i < NUM_SW_COUNTERS; ++i) os << std::setw(11) << s.sw[i] / calls;
+        os << "\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+}
+
+#endif
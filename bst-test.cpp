@@ -1,10 +1,25 @@
 #include <iostream>
 #include <map>
+#include <string>
 #include "bst.h"
 #include "avlbst.h"
+#include "compact-avl.h"
+#include "stack-avl.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "scapegoatbst.h"
+#include "augmented-avl.h"
+#include "interval-avl.h"
+#include "veb-snapshot.h"
+#include "radix-tree.h"
 
 using namespace std;
 
+void printInterval(const std::pair<const Interval<int>, char>& item)
+{
+    cout << " " << item.first << ":" << item.second;
+}
+
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +59,217 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    for(char c = 'a'; c <= 'g'; ++c) {
+        at.insert(std::make_pair(c, c - 'a'));
+    }
+    TreeStats st = at.stats();
+    cout << "\nAVLTree stats: " << st.nodeCount << " nodes, height " << st.height
+         << ", average depth " << st.averageDepth
+         << ", rotations " << st.leftRotations + st.rightRotations << endl;
+    cout << "AVLTree balanced: " << at.isBalanced() << ", valid: " << at.validate() << endl;
+
+    // Compact AVL Tree Tests
+    CompactAVLTree<char,int> ct;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        ct.insert(std::make_pair(c, c - 'a'));
+    }
+    ct.remove('d');
+    cout << "\nCompactAVLTree contents:" << endl;
+    for(CompactAVLTree<char,int>::iterator it = ct.begin(); it != ct.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "CompactAVLTree valid: " << ct.validate() << ", node bytes: "
+         << sizeof(CompactAVLNode<int,int>) << " vs " << sizeof(AVLNode<int,int>) << endl;
+
+    // Parent-pointer-free AVL Tree Tests
+    StackAVLTree<char,int> sat;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        sat.insert(std::make_pair(c, c - 'a'));
+    }
+    sat.remove('d');
+    cout << "\nStackAVLTree contents:" << endl;
+    for(StackAVLTree<char,int>::iterator it = sat.find('e'); it != sat.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "StackAVLTree valid: " << sat.validate() << endl;
+
+    // Splay Tree Tests
+    SplayTree<char,int> spt;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        spt.insert(std::make_pair(c, c - 'a'));
+    }
+    spt.remove('d');
+    if(spt.find('b') != spt.end()) {
+        cout << "\nSplayTree found b" << endl;
+    }
+    cout << "SplayTree valid: " << spt.validate() << ", size " << spt.size() << endl;
+
+    // Red-Black Tree Tests
+    RedBlackTree<char,int> rbt;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        rbt.insert(std::make_pair(c, c - 'a'));
+    }
+    rbt.remove('d');
+    rbt.remove('a');
+    cout << "\nRedBlackTree contents:" << endl;
+    for(RedBlackTree<char,int>::iterator it = rbt.begin(); it != rbt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "RedBlackTree valid: " << rbt.validate() << ", node bytes: "
+         << sizeof(RBNode<int,int>) << " vs " << sizeof(Node<int,int>) << endl;
+
+    // Scapegoat Tree Tests
+    ScapegoatTree<int,int> sgt;
+    for(int i = 0; i < 100; ++i) {
+        sgt.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 100; i += 3) {
+        sgt.remove(i);
+    }
+    cout << "\nScapegoatTree size " << sgt.size() << ", height " << sgt.height()
+         << ", rebuilds " << sgt.rebuilds() << ", valid: " << sgt.validate() << endl;
+
+    // Lookup Cache Tests
+    AVLTree<int,int> cached;
+    cached.enableLookupCache(8);
+    for(int i = 0; i < 20; ++i) {
+        cached.insert(std::make_pair(i, i * i));
+    }
+    cached[4] = 5;
+    cached.remove(4);
+    cout << "\nCached AVLTree find(4) after remove: "
+         << (cached.find(4) == cached.end() ? "not found" : "found")
+         << ", cached[7] = " << cached[7] << endl;
+
+    // Hinted Insert and Finger Search Tests
+    AVLTree<int,int> appended;
+    AVLTree<int,int>::iterator hint = appended.end();
+    for(int i = 0; i < 1000; ++i) {
+        hint = appended.insert(hint, std::make_pair(i, i));
+    }
+    AVLTree<int,int>::iterator near = appended.findFrom(hint, 990);
+    cout << "\nHinted AVLTree size " << appended.size() << ", valid: " << appended.validate()
+         << ", findFrom(999, 990) = " << near->second << endl;
+
+    // Lazy Removal Tests
+    AVLTree<int,int> lazy;
+    lazy.enableLazyRemove(0.5);
+    for(int i = 0; i < 10; ++i) {
+        lazy.insert(std::make_pair(i, i));
+    }
+    lazy.remove(3);
+    lazy.remove(4);
+    lazy.insert(std::make_pair(4, 40));
+    cout << "\nLazy AVLTree contents:";
+    for(AVLTree<int,int>::iterator it = lazy.begin(); it != lazy.end(); ++it) {
+        cout << " " << it->first << ":" << it->second;
+    }
+    cout << endl << "Lazy AVLTree size " << lazy.size() << ", nodes " << lazy.stats().bytesUsed / sizeof(AVLNode<int,int>)
+         << ", valid: " << lazy.validate() << endl;
+    for(int i = 5; i < 10; ++i) {
+        lazy.remove(i);
+    }
+    cout << "Lazy AVLTree needs compaction: " << lazy.needsCompaction();
+    lazy.compact();
+    cout << ", after compact() size " << lazy.size() << ", nodes " << lazy.stats().bytesUsed / sizeof(AVLNode<int,int>)
+         << ", valid: " << lazy.validate() << endl;
+
+    // Heterogeneous Lookup Tests
+    AVLTree<std::string,int> routes;
+    const char* names[] = { "alpha", "beta", "delta", "gamma" };
+    for(int i = 0; i < 4; ++i) {
+        routes.insert(std::make_pair(std::string(names[i]), i));
+    }
+    routes.remove("alpha");
+    cout << "\nString AVLTree find(\"beta\") = " << routes.find("beta")->second
+         << ", lower_bound(\"c\") = " << routes.lower_bound("c")->first
+         << ", contains(\"alpha\") = " << routes.contains("alpha") << endl;
+
+    // Range Aggregate Tests
+    AugmentedAVLTree<int,int,SumMonoid<int> > sums;
+    for(int i = 1; i <= 100; ++i) {
+        sums.insert(std::make_pair(i, i));
+    }
+    sums.remove(50);
+    sums.insert(std::make_pair(10, 0));
+    cout << "\nAugmentedAVLTree sum(1..100) = " << sums.aggregate()
+         << ", sum(5..55) = " << sums.aggregate(5, 55)
+         << ", valid: " << sums.validate() << endl;
+
+    // Interval Tree Tests
+    IntervalTree<int,char> meetings;
+    meetings.insert(std::make_pair(Interval<int>(9, 10), 'a'));
+    meetings.insert(std::make_pair(Interval<int>(9, 12), 'b'));
+    meetings.insert(std::make_pair(Interval<int>(11, 13), 'c'));
+    meetings.insert(std::make_pair(Interval<int>(14, 15), 'd'));
+    cout << "\nIntervalTree overlapping [10, 11]:";
+    meetings.overlapping(10, 11, printInterval);
+    cout << endl << "IntervalTree valid: " << meetings.validate() << endl;
+
+    // Node Handle Tests
+    AVLTree<int,char> shardA, shardB;
+    for(int i = 0; i < 6; ++i) {
+        shardA.insert(std::make_pair(i, (char)('a' + i)));
+        shardB.insert(std::make_pair(i + 4, (char)('A' + i)));
+    }
+    AVLTree<int,char>::node_type handle = shardA.extract(2);
+    handle.key() = 20;
+    shardB.insert(std::move(handle));
+    shardB.merge(shardA);
+    cout << "\nAVLTree after extract and merge:";
+    for(AVLTree<int,char>::iterator it = shardB.begin(); it != shardB.end(); ++it) {
+        cout << " " << it->first << ":" << it->second;
+    }
+    cout << endl << "Left behind: " << shardA.size() << ", valid: "
+         << shardA.validate() << shardB.validate() << endl;
+
+    // Copy, Move and Swap Tests
+    RedBlackTree<char,int> rbCopy(rbt);
+    rbCopy.insert(std::make_pair('z', 25));
+    RedBlackTree<char,int> rbMoved(std::move(rbCopy));
+    rbt.swap(rbMoved);
+    cout << "\nRedBlackTree copy sizes: " << rbt.size() << " " << rbMoved.size() << " " << rbCopy.size()
+         << ", valid: " << rbt.validate() << rbMoved.validate() << endl;
+
+    // Min/Max and Priority Queue Tests
+    AVLTree<int,char> timers;
+    cout << "\nEmpty AVLTree begin() == end(): " << (timers.begin() == timers.end()) << endl;
+    timers.insert(std::make_pair(30, 'c'));
+    timers.insert(std::make_pair(10, 'a'));
+    timers.insert(std::make_pair(20, 'b'));
+    timers.insert(std::make_pair(40, 'd'));
+    cout << "AVLTree front " << timers.front().first << ", back " << timers.back().first;
+    cout << ", popMin " << timers.popMin().mapped();
+    cout << ", popMax " << timers.popMax().mapped();
+    cout << ", front " << timers.front().first << ", valid: " << timers.validate() << endl;
+
+    // Van Emde Boas Snapshot Tests
+    VebSnapshot<int,int> snapshot(appended);
+    cout << "\nVebSnapshot of " << snapshot.size() << " items, height " << snapshot.height()
+         << ", find(500) = " << snapshot.find(500)->second
+         << ", lower_bound(1000) is end: " << (snapshot.lower_bound(1000) == snapshot.end())
+         << ", valid: " << snapshot.validate() << endl;
+
+    // Radix Tree Tests
+    RadixTree<int> pages;
+    const char* urls[] = { "https://example.com/api/v1/users", "https://example.com/api/v1/orders",
+                           "https://example.com/api/v2/users", "https://example.com/about", "https://example.com" };
+    for(int i = 0; i < 5; ++i) {
+        pages.insert(std::make_pair(std::string(urls[i]), i));
+    }
+    pages.remove("https://example.com/api/v1/orders");
+    cout << "\nRadixTree contents:" << endl;
+    for(RadixTree<int>::iterator it = pages.begin(); it != pages.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "RadixTree lower_bound(\"https://example.com/api/v1/x\") = "
+         << pages.lower_bound("https://example.com/api/v1/x")->first
+         << ", nodes " << pages.nodeCount() << ", valid: " << pages.validate() << endl;
+
+#ifdef BST_PERF
+    cout << "\nOperation counters:" << endl;
+    bstperf::report(cout);
+#endif
+
     return 0;
 }
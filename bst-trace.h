@@ -0,0 +1,320 @@
+#ifndef BST_TRACE_H
+#define BST_TRACE_H
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+
+/**
+ * Opt-in recording of the operations done on the search trees, for
+ * replaying real traffic offline with tree-replay.
+ *
+ * Nothing in this file is used unless the trees are compiled with
+ * -DBST_TRACE (see DEFS in the Makefile). Even then nothing is recorded
+ * until bsttrace::start<Key>(out) is called on a thread; from then until
+ * stop(), every insert, remove, find, begin() and iterator increment on a
+ * tree keyed by Key on that thread is appended to out. Calls on trees
+ * with any other key type are counted as dropped, even one written the
+ * same way (an int tree while recording long), so one trace holds the
+ * traffic of one key type (trace one tree at a time for a faithful
+ * replay). Heterogeneous lookups on a tree keyed by Key, such as
+ * find("name") on a std::string tree, are recorded. Values are not recorded; tree-replay inserts its own.
+ * Extracts and pops are recorded as removes, node handle inserts as
+ * inserts, contains() and operator[] as finds, and clearing or
+ * destroying a non-empty tree as a clear. Merges, copies and aggregate
+ * queries are not recorded.
+ *
+ * For example, to record a run of a service keyed by std::string:
+ *
+ *     std::ofstream out("service.trace", std::ios::binary);
+ *     bsttrace::start<std::string>(out);
+ *     ...
+ *     bsttrace::stop();
+ *
+ * Format: the bytes "BSTT", a version byte, and a key kind byte ('i'
+ * signed integer, 'u' unsigned integer, 'f' floating point, 's' string),
+ * followed by one event byte per call. Keyed events are followed by the
+ * key: integers as LEB128 varints (zigzag for signed ones), floating
+ * point as the 8 bytes of a host-order double, strings as a varint
+ * length and the bytes. A find on an integer key costs 2 or 3 bytes.
+ */
+namespace bsttrace {
+
+enum Event { EV_INSERT, EV_REMOVE, EV_FIND, EV_LOWER_BOUND, EV_BEGIN, EV_NEXT, EV_CLEAR, NUM_EVENTS };
+
+const char magic[4] = { 'B', 'S', 'T', 'T' };
+const unsigned char version = 1;
+
+/**
+ * Appends value as an unsigned LEB128 varint.
+ */
+inline void writeVarint(std::string& out, uint64_t value)
+{
+    while(value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+/**
+ * Reads an unsigned LEB128 varint. Returns false at end of input.
+ */
+inline bool readVarint(std::istream& in, uint64_t& value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if(byte == EOF) return false;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * How keys of type K are written and read. kind is 0 for key types
+ * that cannot be traced, whose calls are dropped.
+ */
+template <typename K, typename Enable = void>
+struct KeyCodec
+{
+    static const char kind = 0;
+    static void write(std::string&, const K&) {}
+};
+
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_integral<K>::value && std::is_signed<K>::value>::type>
+{
+    static const char kind = 'i';
+    static void write(std::string& out, K key)
+    {
+        int64_t v = (int64_t)key;
+        writeVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    static bool read(std::istream& in, K& key)
+    {
+        uint64_t v;
+        if(!readVarint(in, v)) return false;
+        key = (K)(int64_t)((v >> 1) ^ (~(v & 1) + 1));
+        return true;
+    }
+};
+
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_integral<K>::value && !std::is_signed<K>::value>::type>
+{
+    static const char kind = 'u';
+    static void write(std::string& out, K key) { writeVarint(out, (uint64_t)key); }
+    static bool read(std::istream& in, K& key)
+    {
+        uint64_t v;
+        if(!readVarint(in, v)) return false;
+        key = (K)v;
+        return true;
+    }
+};
+
+template <typename K>
+struct KeyCodec<K, typename std::enable_if<std::is_floating_point<K>::value>::type>
+{
+    static const char kind = 'f';
+    static void write(std::string& out, K key)
+    {
+        double d = (double)key;
+        char bytes[sizeof(d)];
+        std::memcpy(bytes, &d, sizeof(d));
+        out.append(bytes, sizeof(d));
+    }
+    static bool read(std::istream& in, K& key)
+    {
+        double d;
+        char bytes[sizeof(d)];
+        if(!in.read(bytes, sizeof(d))) return false;
+        std::memcpy(&d, bytes, sizeof(d));
+        key = (K)d;
+        return true;
+    }
+};
+
+template <>
+struct KeyCodec<std::string>
+{
+    static const char kind = 's';
+    static void write(std::string& out, const std::string& key)
+    {
+        writeVarint(out, key.size());
+        out.append(key);
+    }
+    static bool read(std::istream& in, std::string& key)
+    {
+        uint64_t length;
+        if(!readVarint(in, length)) return false;
+        key.resize(length);
+        return length == 0 || (bool)in.read(&key[0], length);
+    }
+};
+
+// Heterogeneous lookups on string trees, e.g. find("name")
+template <>
+struct KeyCodec<const char*>
+{
+    static const char kind = 's';
+    static void write(std::string& out, const char* key)
+    {
+        size_t length = std::strlen(key);
+        writeVarint(out, length);
+        out.append(key, length);
+    }
+};
+
+template <size_t N>
+struct KeyCodec<char[N]> : KeyCodec<const char*> {};
+
+/**
+ * Per-thread recording state. Events are buffered and written out in
+ * blocks.
+ */
+struct State
+{
+    State() : out(nullptr), type(nullptr), kind(0), recorded(0), dropped(0) {}
+
+    std::ostream* out;
+    // The key type of the trees being recorded
+    const std::type_info* type;
+    char kind;
+    uint64_t recorded;
+    uint64_t dropped;
+    std::string buffer;
+};
+
+inline State& state()
+{
+    static thread_local State s;
+    return s;
+}
+
+const size_t flushBytes = 1 << 16;
+
+/**
+ * Starts recording this thread's calls on trees keyed by Key to out,
+ * which must stay open until stop(). Writes the header.
+ */
+template <typename Key>
+void start(std::ostream& out)
+{
+    State& s = state();
+    s.out = &out;
+    s.type = &typeid(Key);
+    s.kind = KeyCodec<Key>::kind;
+    s.recorded = 0;
+    s.dropped = 0;
+    s.buffer.assign(magic, sizeof(magic));
+    s.buffer.push_back((char)version);
+    s.buffer.push_back(s.kind);
+}
+
+/**
+ * Writes out any buffered events and stops recording.
+ */
+inline void stop()
+{
+    State& s = state();
+    if(s.out == nullptr) return;
+    s.out->write(s.buffer.data(), s.buffer.size());
+    s.out->flush();
+    s.buffer.clear();
+    s.out = nullptr;
+}
+
+/**
+ * Writes the buffer out once it holds a block.
+ */
+inline void flushIfFull(State& s)
+{
+    if(s.buffer.size() >= flushBytes) {
+        s.out->write(s.buffer.data(), s.buffer.size());
+        s.buffer.clear();
+    }
+}
+
+/**
+ * Returns true if calls on trees keyed by Key are being recorded, and
+ * counts the call as dropped if recording is on for another key type.
+ */
+template <typename Key>
+bool tracing(State& s)
+{
+    if(s.out == nullptr) return false;
+    // type_info objects are usually unique, so the address test settles
+    // the common case without comparing names
+    if(s.kind == 0 || (s.type != &typeid(Key) && *s.type != typeid(Key))) {
+        ++s.dropped;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Records a keyed event on a tree keyed by Key. key may be of another
+ * type comparable with Key (a heterogeneous lookup); it is counted as
+ * dropped if it is not written the same way as Key.
+ */
+template <typename Key, typename K>
+void record(Event event, const K& key)
+{
+    State& s = state();
+    if(!tracing<Key>(s)) return;
+    if(KeyCodec<K>::kind != s.kind) {
+        ++s.dropped;
+        return;
+    }
+    s.buffer.push_back((char)event);
+    KeyCodec<K>::write(s.buffer, key);
+    ++s.recorded;
+    flushIfFull(s);
+}
+
+/**
+ * Records an event without a key (begin, next, clear) on a tree keyed
+ * by Key.
+ */
+template <typename Key>
+void record(Event event)
+{
+    State& s = state();
+    if(!tracing<Key>(s)) return;
+    s.buffer.push_back((char)event);
+    ++s.recorded;
+    flushIfFull(s);
+}
+
+inline uint64_t recorded() { return state().recorded; }
+inline uint64_t dropped() { return state().dropped; }
+
+/**
+ * Reads a trace header. Returns the key kind, or 0 if in does not hold
+ * a trace of this version.
+ */
+inline char readHeader(std::istream& in)
+{
+    char header[sizeof(magic) + 2];
+    if(!in.read(header, sizeof(header))) return 0;
+    if(std::memcmp(header, magic, sizeof(magic)) != 0 || (unsigned char)header[sizeof(magic)] != version) return 0;
+    return header[sizeof(magic) + 1];
+}
+
+/**
+ * Returns true if event is followed by a key.
+ */
+inline bool hasKey(Event event)
+{
+    return event == EV_INSERT || event == EV_REMOVE || event == EV_FIND || event == EV_LOWER_BOUND;
+}
+
+}  // namespace bsttrace
+
+#endif
@@ -5,18 +5,59 @@
 #include <exception>
 #include <cstdlib>
 #include <utility>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+#include <stdexcept>
+
+// Compile with -DBST_PERF to record per-operation counters (see bst-perf.h)
+#ifdef BST_PERF
+#include "bst-perf.h"
+#define BST_PERF_SCOPE(op) bstperf::Scope bstPerfScope_(bstperf::op)
+#define BST_PERF_COUNT(counter) bstperf::count(bstperf::counter)
+#else
+#define BST_PERF_SCOPE(op)
+#define BST_PERF_COUNT(counter)
+#endif
+
+// Compile with -DBST_TRACE to allow recording calls for tree-replay
+// (see bst-trace.h)
+#ifdef BST_TRACE
+#include "bst-trace.h"
+#define BST_TRACE_KEY(event, key) bsttrace::record<Key>(bsttrace::event, key)
+#define BST_TRACE_EVENT(event) bsttrace::record<Key>(bsttrace::event)
+#else
+#define BST_TRACE_KEY(event, key)
+#define BST_TRACE_EVENT(event)
+#endif
 
 /**
  * A templated class for a Node in a search tree.
  * The getters for parent/left/right are virtual so
  * that they can be overridden for future kinds of
  * search trees, such as Red Black trees, Splay trees,
- * and AVL trees.
+ * and AVL trees. setParent is virtual as well so that
+ * a node can keep extra bits in its parent pointer.
+ * Trees that remove lazily leave dead nodes linked in
+ * the tree, marked by TOMBSTONE_BIT of the parent
+ * pointer; isTombstone is not virtual, so iterating
+ * and looking up in other trees costs one bit test.
+ *
+ * The children are kept in one array indexed by
+ * direction (LEFT or RIGHT), so code can step toward
+ * child_[key > nodeKey] without a branch and mirrored
+ * cases can share one routine.
  */
 template <typename Key, typename Value>
 class Node
 {
 public:
+    enum Direction { LEFT = 0, RIGHT = 1 };
+
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
     virtual ~Node();
 
@@ -30,16 +71,24 @@ public:
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
 
-    void setParent(Node<Key, Value>* parent);
+    virtual void setParent(Node<Key, Value>* parent);
+    bool isTombstone() const;
+    virtual Node<Key, Value>* clone() const;
     void setLeft(Node<Key, Value>* left);
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
 
+    Node<Key, Value>* getChild(bool dir) const;
+    void setChild(bool dir, Node<Key, Value>* child);
+
 protected:
+    // Set in parent_ only by node types that override getParent and
+    // setParent to hide it; bit 0 stays free for a red-black color
+    static const uintptr_t TOMBSTONE_BIT = 2;
+
     std::pair<const Key, Value> item_;
     Node<Key, Value>* parent_;
-    Node<Key, Value>* left_;
-    Node<Key, Value>* right_;
+    Node<Key, Value>* child_[2];
 };
 
 /*
@@ -54,10 +103,10 @@ protected:
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
     item_(key, value),
-    parent_(parent),
-    left_(NULL),
-    right_(NULL)
+    parent_(parent)
 {
+    child_[LEFT] = NULL;
+    child_[RIGHT] = NULL;
 
 }
 
@@ -132,7 +181,7 @@ Node<Key, Value>* Node<Key, Value>::getParent() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
 {
-    return left_;
+    return child_[LEFT];
 }
 
 /**
@@ -141,7 +190,7 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
 {
-    return right_;
+    return child_[RIGHT];
 }
 
 /**
@@ -153,13 +202,60 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
     parent_ = parent;
 }
 
+/**
+* Whether the node was removed lazily and is waiting for compaction.
+* Only AVLNode ever sets the bit.
+*/
+template<typename Key, typename Value>
+bool Node<Key, Value>::isTombstone() const
+{
+    return (reinterpret_cast<uintptr_t>(parent_) & TOMBSTONE_BIT) != 0;
+}
+
+/**
+* Returns a heap copy of this node, of the same type and with the same
+* item and per-node fields. The copy's links still point into this
+* node's tree; the caller relinks them.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::clone() const
+{
+    return new Node<Key, Value>(*this);
+}
+
+/**
+* Returns the child in direction dir (RIGHT when true). Unlike getLeft()
+* and getRight() this is not virtual, so the search loops can inline it.
+*
+* Both children are loaded and one is picked with a mask. Indexing
+* child_[dir] directly makes the load address wait on the key compare,
+* and compilers turn a ternary over the array into a branch that
+* mispredicts about half the time on random lookups; both measured
+* slower in the random-lookup benchmark.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getChild(bool dir) const
+{
+    uintptr_t mask = -(uintptr_t)dir;
+    return (Node<Key, Value>*)(((uintptr_t)child_[LEFT] & ~mask) | ((uintptr_t)child_[RIGHT] & mask));
+}
+
+/**
+* A setter for the child in direction dir (RIGHT when true).
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setChild(bool dir, Node<Key, Value>* child)
+{
+    child_[dir] = child;
+}
+
 /**
 * A setter for setting the left child of a node.
 */
 template<typename Key, typename Value>
 void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 {
-    left_ = left;
+    child_[LEFT] = left;
 }
 
 /**
@@ -168,7 +264,7 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 template<typename Key, typename Value>
 void Node<Key, Value>::setRight(Node<Key, Value>* right)
 {
-    right_ = right;
+    child_[RIGHT] = right;
 }
 
 /**
@@ -186,6 +282,100 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* How searches pass and compare keys. The general version takes keys by
+* const reference, since copying a key such as a string may allocate, and
+* compares through the node's key in place.
+*/
+template <typename Key, bool Arithmetic = std::is_arithmetic<Key>::value>
+struct BstKeyTraits
+{
+    typedef const Key& param_type;
+
+    /**
+    * Searches the subtree under node. Returns the node holding key, or
+    * null with parent set to the last node visited (left alone if the
+    * subtree is empty).
+    */
+    template <typename Value>
+    static Node<Key, Value>* descend(Node<Key, Value>* node, param_type key, Node<Key, Value>*& parent)
+    {
+        while (node != nullptr) {
+            BST_PERF_COUNT(SW_NODES_VISITED);
+            if (key == node->getKey()) {
+                return node;
+            }
+            parent = node;
+            node = node->getChild(node->getKey() < key);
+        }
+        return nullptr;
+    }
+};
+
+/**
+* Arithmetic keys are passed by value, and each node's key is read once
+* into a local so that the equality and order tests are two compares of
+* one register. (A fully branchless descent, selecting the child with a
+* mask and testing equality only at the leaf, measured slower: it makes
+* every step wait for the previous load, where a predicted branch lets
+* the next node's load start early.)
+*/
+template <typename Key>
+struct BstKeyTraits<Key, true>
+{
+    typedef Key param_type;
+
+    template <typename Value>
+    static Node<Key, Value>* descend(Node<Key, Value>* node, param_type key, Node<Key, Value>*& parent)
+    {
+        while (node != nullptr) {
+            BST_PERF_COUNT(SW_NODES_VISITED);
+            Key nodeKey = node->getKey();
+            if (key == nodeKey) {
+                return node;
+            }
+            parent = node;
+            node = node->getChild(nodeKey < key);
+        }
+        return nullptr;
+    }
+};
+
+/**
+* Hashes keys for the optional lookup cache (see enableLookupCache()).
+* Keys without a std::hash specialization get enabled == false, and the
+* cache then stays off for their trees.
+*/
+template <typename Key, typename Enable = void>
+struct BstKeyHash
+{
+    static const bool enabled = false;
+    static size_t hash(const Key&) { return 0; }
+};
+
+template <typename Key>
+struct BstKeyHash<Key, decltype(void(std::hash<Key>()(std::declval<const Key&>())))>
+{
+    static const bool enabled = true;
+    static size_t hash(const Key& key) { return std::hash<Key>()(key); }
+};
+
+/**
+* A snapshot of the shape of a tree, as returned by BinarySearchTree::stats().
+* Depths count nodes, so the root is at depth 1 and a search for the
+* deepest key visits height nodes.
+*/
+struct TreeStats
+{
+    size_t nodeCount;
+    int height;
+    double averageDepth;
+    size_t leftRotations;
+    size_t rightRotations;
+    size_t bytesUsed;
+    std::vector<size_t> depthHistogram; // depthHistogram[d] = nodes at depth d + 1
+};
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -194,16 +384,28 @@ class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    BinarySearchTree(const BinarySearchTree<Key, Value>& other);
+    BinarySearchTree(BinarySearchTree<Key, Value>&& other);
+    BinarySearchTree<Key, Value>& operator=(const BinarySearchTree<Key, Value>& other);
+    BinarySearchTree<Key, Value>& operator=(BinarySearchTree<Key, Value>&& other);
     virtual ~BinarySearchTree(); //TODO
+    virtual void swap(BinarySearchTree<Key, Value>& other);
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
     bool isBalanced() const; //TODO
+    int height() const;
+    virtual bool validate() const;
     void print() const;
     bool empty() const;
+    size_t size() const;
+    TreeStats stats() const;
+    void enableLookupCache(size_t slots);
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename IKey, typename IValue>
+    friend class InterleavedFinder;
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -223,67 +425,151 @@ public:
 
     protected:
         friend class BinarySearchTree<Key, Value>;
+        template<typename IKey, typename IValue>
+        friend class InterleavedFinder;
         iterator(Node<Key,Value>* ptr);
         Node<Key, Value> *current_;
     };
 
+    /**
+    * An owning handle to a node extracted from a tree, modelled on
+    * std::map::node_type. It can be moved but not copied, and deletes the
+    * node if it is destroyed without being inserted.
+    */
+    class node_type
+    {
+    public:
+        node_type();
+        node_type(node_type&& other);
+        node_type& operator=(node_type&& other);
+        ~node_type();
+
+        bool empty() const;
+        explicit operator bool() const;
+        Key& key() const;
+        Value& mapped() const;
+
+    protected:
+        friend class BinarySearchTree<Key, Value>;
+        node_type(Node<Key, Value>* node, const std::type_info* owner);
+        node_type(const node_type&);
+        node_type& operator=(const node_type&);
+        Node<Key, Value>* node_;
+        // Dynamic type of the tree the node came from, which fixes its node type
+        const std::type_info* owner_;
+    };
+
+    /**
+    * The result of inserting a node handle: where its key now is, whether
+    * the node was linked in, and the handle back if it was not.
+    */
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
 public:
     iterator begin() const;
     iterator end() const;
+    const std::pair<const Key, Value>& front() const;
+    const std::pair<const Key, Value>& back() const;
+    node_type popMin();
+    node_type popMax();
     iterator find(const Key& key) const;
+    template<typename K> iterator find(const K& key) const;
+    template<typename K> iterator lower_bound(const K& key) const;
+    template<typename K> bool contains(const K& key) const;
+    template<typename K> void remove(const K& key);
+    iterator findFrom(iterator hint, const Key& key) const;
+    iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    node_type extract(const Key& key);
+    node_type extract(iterator position);
+    insert_return_type insert(node_type&& handle);
+    void merge(BinarySearchTree<Key, Value>& source);
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    Node<Key, Value>* internalFind(typename BstKeyTraits<Key>::param_type k) const; // TODO
     Node<Key, Value> *getSmallestNode() const;  // TODO
+    Node<Key, Value>* liveNeighbor(Node<Key, Value>* node, bool dir) const;
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     static Node<Key, Value>* successor(Node<Key, Value>* current); // TODO
+    static Node<Key, Value>* neighbor(Node<Key, Value>* current, bool dir);
+    Node<Key, Value>* rotate(Node<Key, Value>* node, bool dir);
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
+    virtual size_t nodeBytes() const;
+    size_t cacheSlot(const Key& key) const;
+    Node<Key, Value>* cachedFind(const Key& key) const;
+    Node<Key, Value>* descend(Node<Key, Value>* start, typename BstKeyTraits<Key>::param_type key, Node<Key, Value>*& parent) const;
+    Node<Key, Value>* climbFrom(Node<Key, Value>* finger, const Key& key) const;
+    template<typename K> Node<Key, Value>* lowerBoundNode(const K& key) const;
+    template<typename K> Node<Key, Value>* lookup(const K& key) const;
+    bool isLive(Node<Key, Value>* node) const;
+    void moveExtremesOff(Node<Key, Value>* node);
+    void noteExtreme(Node<Key, Value>* node);
+    virtual void reviveNode(Node<Key, Value>* node);
+    virtual void updateValue(Node<Key, Value>* node, const Value& value);
+    virtual Node<Key, Value>* createNode(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent);
+    Node<Key, Value>* attachNode(Node<Key, Value>* parent, const std::pair<const Key, Value>& keyValuePair);
+    virtual void linkNode(Node<Key, Value>* parent, Node<Key, Value>* node);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void detachNode(Node<Key, Value>* node);
+    void unlinkNode(Node<Key, Value>* node);
+    void uncacheNode(Node<Key, Value>* node);
+    void destroyNode(Node<Key, Value>* node);
+    node_type extractNode(Node<Key, Value>* node);
+    void checkOwner(const std::type_info& owner) const;
+    void cloneNodes(const BinarySearchTree<Key, Value>& other);
+    void swapMembers(BinarySearchTree<Key, Value>& other);
+
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2);
 
     // Add helper functions here
-    template <typename Func>
-    void dfs(Node<Key, Value>* node, Func function) {
-      if (node->getLeft() != nullptr) {
-        dfs(node->getLeft(), function);
-      }
-      if (node->getRight() != nullptr) {
-        dfs(node->getRight(), function);
-      }
-      function(node);
-    }
 
-    bool isTreeBalanced(Node<Key, Value>* node) {
-      int leftDepth = 0;
-      int rightDepth = 0;
-      if (node->getLeft() != nullptr) {
-        bool isTwoDeep = node->getLeft()->getLeft() != nullptr || node->getLeft()->getRight() != nullptr;
-        leftDepth = isTwoDeep ? 2 : 1;
-      }
-      if (node->getRight() != nullptr) {
-        bool isTwoDeep = node->getRight()->getLeft() != nullptr || node->getRight()->getRight() != nullptr;
-        rightDepth = isTwoDeep ? 2 : 1;
-      }
-      if (abs(leftDepth - rightDepth) > 1) {
-        return false;
-      }
-      else if (leftDepth < 2 && rightDepth < 2) {
-        return true;
-      }
-      else {
-        return isTreeBalanced(node->getLeft()) && isTreeBalanced(node->getRight());
-      }
-    }
+    /**
+    * The height and key range of one subtree, as seen by checkSubtrees().
+    * An empty subtree has height 0 and null min/max.
+    */
+    struct SubtreeSummary
+    {
+        int height;
+        Node<Key, Value>* min;
+        Node<Key, Value>* max;
+    };
+
+    template <typename Check>
+    int checkSubtrees(Check check) const;
+    virtual bool checkNode(Node<Key, Value>* node, int leftHeight, int rightHeight) const;
 
 protected:
     Node<Key, Value>* root_;
     // You should not need other data members
+    // The first and last live nodes in key order, or null when there are
+    // none; tombstones beyond them are passed over. Rotations, swaps and
+    // rebuilds never change which nodes these are; only linking,
+    // unlinking, removing lazily and reviving do.
+    Node<Key, Value>* leftmost_;
+    Node<Key, Value>* rightmost_;
+    size_t size_;
+    size_t leftRotations_;
+    size_t rightRotations_;
+    // Two-way set-associative hot-key cache, set s in entries 2s and
+    // 2s + 1 (most recently found first); empty when disabled. Entries
+    // are null or point at linked nodes, possibly tombstones: a lazy
+    // remove does not uncache its node, so every hit is checked with
+    // isLive(). A node is uncached before it is deleted or extracted.
+    mutable std::vector<Node<Key, Value>*> cache_;
+    int cacheShift_;
+    // Nodes still linked into the tree but removed lazily; not in size_
+    size_t tombstones_;
 };
 
 /*
@@ -362,7 +648,13 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator&
 BinarySearchTree<Key, Value>::iterator::operator++() {
   // TODO
-  current_ = successor(current_);
+  BST_PERF_SCOPE(OP_ITERATE);
+  BST_TRACE_EVENT(EV_NEXT);
+  // Tombstones left by lazy removal are skipped; in trees without any
+  // this is one bit test of the node just reached
+  do {
+    current_ = successor(current_);
+  } while (current_ != nullptr && current_->isTombstone());
   return *this;
 }
 
@@ -373,6 +665,106 @@ End implementations for the BinarySearchTree::iterator class.
 -------------------------------------------------------------
 */
 
+/*
+---------------------------------------------------------------
+Begin implementations for the BinarySearchTree::node_type class.
+---------------------------------------------------------------
+*/
+
+/**
+* An empty handle.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type() : node_(nullptr), owner_(nullptr)
+{
+
+}
+
+/**
+* Takes ownership of an unlinked node that came from a tree of type owner.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type(Node<Key, Value>* node, const std::type_info* owner) :
+    node_(node), owner_(owner)
+{
+
+}
+
+/**
+* Takes the node from other, leaving it empty.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::node_type(node_type&& other) : node_(other.node_), owner_(other.owner_)
+{
+    other.node_ = nullptr;
+    other.owner_ = nullptr;
+}
+
+/**
+* Deletes any node held, then takes the node from other.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type&
+BinarySearchTree<Key, Value>::node_type::operator=(node_type&& other)
+{
+    if (this != &other) {
+        delete node_;
+        node_ = other.node_;
+        owner_ = other.owner_;
+        other.node_ = nullptr;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+/**
+* Deletes the node if the handle still owns one.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::~node_type()
+{
+    delete node_;
+}
+
+template<class Key, class Value>
+bool BinarySearchTree<Key, Value>::node_type::empty() const
+{
+    return node_ == nullptr;
+}
+
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::node_type::operator bool() const
+{
+    return node_ != nullptr;
+}
+
+/**
+* The key of the held node. As with std::map's handle, it may be changed
+* while the node is out of any tree, so an item can be re-keyed without
+* copying its value. The handle must not be empty.
+*/
+template<class Key, class Value>
+Key& BinarySearchTree<Key, Value>::node_type::key() const
+{
+    return const_cast<Key&>(node_->getItem().first);
+}
+
+/**
+* The value of the held node, which may be modified before reinserting.
+* The handle must not be empty.
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::node_type::mapped() const
+{
+    return node_->getValue();
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the BinarySearchTree::node_type class.
+-------------------------------------------------------------
+*/
+
 /*
 -----------------------------------------------------
 Begin implementations for the BinarySearchTree class.
@@ -386,6 +778,79 @@ template<class Key, class Value>
 BinarySearchTree<Key, Value>::BinarySearchTree() {
   // TODO
   root_ = nullptr;
+  leftmost_ = nullptr;
+  rightmost_ = nullptr;
+  size_ = 0;
+  leftRotations_ = 0;
+  rightRotations_ = 0;
+  cacheShift_ = 64;
+  tombstones_ = 0;
+}
+
+/**
+* Copies other in O(n) without re-inserting: every node is cloned in
+* place, so the copy has the same shape, and keeps balances, colors,
+* aggregates and tombstones. Rotation counters and the lookup cache's
+* size are copied; its entries start empty.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(const BinarySearchTree<Key, Value>& other) :
+  root_(nullptr), leftmost_(nullptr), rightmost_(nullptr), size_(other.size_), leftRotations_(other.leftRotations_),
+  rightRotations_(other.rightRotations_), cache_(other.cache_.size(), nullptr),
+  cacheShift_(other.cacheShift_), tombstones_(other.tombstones_)
+{
+  cloneNodes(other);
+}
+
+/**
+* Takes other's nodes in O(1), leaving other empty.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(BinarySearchTree<Key, Value>&& other) :
+  root_(other.root_), leftmost_(other.leftmost_), rightmost_(other.rightmost_),
+  size_(other.size_), leftRotations_(other.leftRotations_),
+  rightRotations_(other.rightRotations_), cache_(std::move(other.cache_)),
+  cacheShift_(other.cacheShift_), tombstones_(other.tombstones_)
+{
+  other.root_ = nullptr;
+  other.leftmost_ = nullptr;
+  other.rightmost_ = nullptr;
+  other.size_ = 0;
+  other.leftRotations_ = 0;
+  other.rightRotations_ = 0;
+  other.cache_.clear();
+  other.cacheShift_ = 64;
+  other.tombstones_ = 0;
+}
+
+/**
+* Replaces the contents with a clone of other, as the copy constructor
+* makes. If a copy throws, this tree is left unchanged. other must have
+* the same type as this tree, or std::invalid_argument is thrown.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>& BinarySearchTree<Key, Value>::operator=(const BinarySearchTree<Key, Value>& other) {
+  checkOwner(typeid(other));
+  if (this != &other) {
+    BinarySearchTree<Key, Value> copy(other);
+    swapMembers(copy);
+  }
+  return *this;
+}
+
+/**
+* Frees the contents, then takes other's nodes in O(1), leaving other
+* empty. other must have the same type as this tree, or
+* std::invalid_argument is thrown.
+*/
+template<typename Key, typename Value>
+BinarySearchTree<Key, Value>& BinarySearchTree<Key, Value>::operator=(BinarySearchTree<Key, Value>&& other) {
+  checkOwner(typeid(other));
+  if (this != &other) {
+    clear();
+    swapMembers(other);
+  }
+  return *this;
 }
 
 template<typename Key, typename Value>
@@ -400,7 +865,16 @@ BinarySearchTree<Key, Value>::~BinarySearchTree() {
 template<class Key, class Value>
 bool BinarySearchTree<Key, Value>::empty() const
 {
-    return root_ == NULL;
+    return size_ == 0;
+}
+
+/**
+ * Returns the number of items in the tree
+*/
+template<class Key, class Value>
+size_t BinarySearchTree<Key, Value>::size() const
+{
+    return size_;
 }
 
 template<typename Key, typename Value>
@@ -411,16 +885,75 @@ void BinarySearchTree<Key, Value>::print() const
 }
 
 /**
-* Returns an iterator to the "smallest" item in the tree
+* Returns an iterator to the "smallest" item in the tree, or end() if
+* the tree is empty. O(1), lazily removed keys at the front included.
 */
 template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    BST_TRACE_EVENT(EV_BEGIN);
+    BinarySearchTree<Key, Value>::iterator begin(leftmost_);
     return begin;
 }
 
+/**
+* Returns the item with the smallest key in O(1), as begin() does.
+* Throws std::out_of_range if the tree is empty.
+*/
+template<class Key, class Value>
+const std::pair<const Key, Value>& BinarySearchTree<Key, Value>::front() const
+{
+    Node<Key, Value>* first = leftmost_;
+    if (first == nullptr) throw std::out_of_range("Empty tree");
+    return first->getItem();
+}
+
+/**
+* Returns the item with the largest key in O(1), as front() does.
+* Throws std::out_of_range if the tree is empty.
+*/
+template<class Key, class Value>
+const std::pair<const Key, Value>& BinarySearchTree<Key, Value>::back() const
+{
+    Node<Key, Value>* last = rightmost_;
+    if (last == nullptr) throw std::out_of_range("Empty tree");
+    return last->getItem();
+}
+
+/**
+* Extracts the item with the smallest key, as extract() does, so that
+* the tree can serve as a double-ended priority queue. Finding the item
+* is O(1) and unlinking it takes O(1) amortized rebalancing in AVL and
+* red-black trees. Returns an empty handle if the tree is empty.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type
+BinarySearchTree<Key, Value>::popMin()
+{
+    BST_PERF_SCOPE(OP_REMOVE);
+    Node<Key, Value>* first = leftmost_;
+    if (first != nullptr) {
+        BST_TRACE_KEY(EV_REMOVE, first->getKey());
+    }
+    return first == nullptr ? node_type() : extractNode(first);
+}
+
+/**
+* Extracts the item with the largest key, as popMin() does.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type
+BinarySearchTree<Key, Value>::popMax()
+{
+    BST_PERF_SCOPE(OP_REMOVE);
+    Node<Key, Value>* last = rightmost_;
+    if (last != nullptr) {
+        BST_TRACE_KEY(EV_REMOVE, last->getKey());
+    }
+    return last == nullptr ? node_type() : extractNode(last);
+}
+
 /**
 * Returns an iterator whose value means INVALID
 */
@@ -440,11 +973,75 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::find(const Key & k) const
 {
-    Node<Key, Value> *curr = internalFind(k);
+    BST_TRACE_KEY(EV_FIND, k);
+    Node<Key, Value> *curr = cachedFind(k);
     BinarySearchTree<Key, Value>::iterator it(curr);
     return it;
 }
 
+/**
+* Heterogeneous find: key may be of any type that can be compared with
+* Key by operator< in both orders, such as a const char* against
+* std::string keys, so no Key is constructed for the lookup. These
+* lookups bypass the lookup cache, which is keyed by Key hashes.
+*/
+template<class Key, class Value>
+template<typename K>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::find(const K& key) const
+{
+    BST_TRACE_KEY(EV_FIND, key);
+    Node<Key, Value>* curr = lookup(key);
+    return iterator(isLive(curr) ? curr : nullptr);
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none. key may be a Key or any type comparable
+* with it, as for find().
+*/
+template<class Key, class Value>
+template<typename K>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::lower_bound(const K& key) const
+{
+    BST_PERF_SCOPE(OP_FIND);
+    BST_TRACE_KEY(EV_LOWER_BOUND, key);
+    Node<Key, Value>* bound = lowerBoundNode(key);
+    while (!isLive(bound)) {
+        bound = successor(bound);
+    }
+    return iterator(bound);
+}
+
+/**
+* Returns true if an item with the given key is in the tree. key may be
+* a Key or any type comparable with it, as for find().
+*/
+template<class Key, class Value>
+template<typename K>
+bool BinarySearchTree<Key, Value>::contains(const K& key) const
+{
+    return find(key) != end();
+}
+
+/**
+* Heterogeneous remove: removes the item whose key compares equal to key,
+* which may be of any type comparable with Key, as for find(). Does
+* nothing if there is no such item.
+*/
+template<class Key, class Value>
+template<typename K>
+void BinarySearchTree<Key, Value>::remove(const K& key)
+{
+    BST_PERF_SCOPE(OP_REMOVE);
+    BST_TRACE_KEY(EV_REMOVE, key);
+    Node<Key, Value>* currNode = lookup(key);
+    if (currNode != nullptr && isLive(currNode)) {
+        removeNode(currNode);
+    }
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -452,14 +1049,16 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
 template<class Key, class Value>
 Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
 {
-    Node<Key, Value> *curr = internalFind(key);
+    BST_TRACE_KEY(EV_FIND, key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
 template<class Key, class Value>
 Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 {
-    Node<Key, Value> *curr = internalFind(key);
+    BST_TRACE_KEY(EV_FIND, key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
@@ -473,35 +1072,379 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair) {
   // TODO
-  if (root_ == nullptr) {
-    root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
+  BST_PERF_SCOPE(OP_INSERT);
+  BST_TRACE_KEY(EV_INSERT, keyValuePair.first);
+  Node<Key, Value>* parentNode = nullptr;
+  Node<Key, Value>* currNode = descend(root_, keyValuePair.first, parentNode);
+  if (currNode != nullptr) {
+    if (!isLive(currNode)) {
+      reviveNode(currNode);
+    }
+    updateValue(currNode, keyValuePair.second);
     return;
   }
+  attachNode(parentNode, keyValuePair);
+}
 
-  Node<Key, Value>* currNode = nullptr;
-  Node<Key, Value>* nextNode = root_;
-  while (nextNode != nullptr) {
-    currNode = nextNode;
-
-    if (keyValuePair.first == currNode->getKey()) {
-      currNode->setValue(keyValuePair.second);
-      return;
-    }
-    else if (keyValuePair.first < currNode->getKey()) {
-      nextNode = currNode->getLeft();
-    }
-    else {
-      nextNode = currNode->getRight();
+/**
+* Inserts keyValuePair starting the search at hint rather than at the
+* root, and returns an iterator to the inserted or updated item. The
+* search climbs from hint only until it reaches a subtree whose key range
+* holds the key, so a hint d positions away costs O(log d) comparisons in
+* a balanced tree. An end() hint searches from the root.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &keyValuePair) {
+  BST_PERF_SCOPE(OP_INSERT);
+  BST_TRACE_KEY(EV_INSERT, keyValuePair.first);
+  Node<Key, Value>* parentNode = nullptr;
+  Node<Key, Value>* start = climbFrom(hint.current_, keyValuePair.first);
+  Node<Key, Value>* currNode = descend(start, keyValuePair.first, parentNode);
+  if (currNode != nullptr) {
+    if (!isLive(currNode)) {
+      reviveNode(currNode);
     }
+    updateValue(currNode, keyValuePair.second);
+    return iterator(currNode);
   }
+  return iterator(attachNode(parentNode, keyValuePair));
+}
 
-  // currNode is the parent of the new node
-  if (keyValuePair.first < currNode->getKey()) {
-    currNode->setLeft(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, currNode));
-  }
+/**
+* Unlinks the item with the given key and returns it in a node handle,
+* or an empty handle if the key is not present. Nothing is copied or
+* freed: the node itself moves into the handle, and can be inserted
+* back into this tree, or any tree of the same type, without allocating.
+* Other iterators stay valid. Trees in lazy mode unlink the node eagerly,
+* as they must hand it out.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type
+BinarySearchTree<Key, Value>::extract(const Key& key) {
+  BST_PERF_SCOPE(OP_REMOVE);
+  BST_TRACE_KEY(EV_REMOVE, key);
+  // As remove() does, this bypasses the lookup cache: caching a node
+  // that leaves the tree at once would only evict a hot entry
+  Node<Key, Value>* currNode = lookup(key);
+  if (currNode == nullptr || !isLive(currNode)) {
+    return node_type();
+  }
+  return extractNode(currNode);
+}
+
+/**
+* Unlinks the item at position, which must be a valid dereferenceable
+* iterator into this tree, and returns it in a node handle.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::node_type
+BinarySearchTree<Key, Value>::extract(iterator position) {
+  BST_PERF_SCOPE(OP_REMOVE);
+  BST_TRACE_KEY(EV_REMOVE, position.current_->getKey());
+  return extractNode(position.current_);
+}
+
+/**
+* Links the node held by handle into the tree if its key is not already
+* present, without allocating or copying the item. If the key is present
+* the handle is returned unchanged in the result. If the key is present
+* only as a lazily removed tombstone, the tombstone is revived with the
+* handle's value instead, and the handle's node is freed. An empty handle
+* inserts nothing. Throws std::invalid_argument if the node came from a
+* tree of another type, whose nodes may have a different layout.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::insert_return_type
+BinarySearchTree<Key, Value>::insert(node_type&& handle) {
+  BST_PERF_SCOPE(OP_INSERT);
+  insert_return_type result;
+  result.inserted = false;
+  if (handle.empty()) {
+    return result;
+  }
+  checkOwner(*handle.owner_);
+  BST_TRACE_KEY(EV_INSERT, handle.key());
+  Node<Key, Value>* parentNode = nullptr;
+  Node<Key, Value>* currNode = descend(root_, handle.key(), parentNode);
+  if (currNode == nullptr) {
+    linkNode(parentNode, handle.node_);
+    result.position = iterator(handle.node_);
+    handle.node_ = nullptr;
+    handle.owner_ = nullptr;
+    result.inserted = true;
+  }
+  else if (!isLive(currNode)) {
+    reviveNode(currNode);
+    updateValue(currNode, handle.mapped());
+    result.position = iterator(currNode);
+    result.inserted = true;
+    handle = node_type();
+  }
+  else {
+    result.position = iterator(currNode);
+    result.node = std::move(handle);
+  }
+  return result;
+}
+
+/**
+* Moves every item of source whose key is not in this tree into this
+* tree, relinking the nodes rather than copying them. Items whose keys
+* are already here stay in source. source must have the same type as
+* this tree, or std::invalid_argument is thrown. Costs one search in each
+* tree per item of source.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::merge(BinarySearchTree<Key, Value>& source) {
+  checkOwner(typeid(source));
+  if (&source == this) {
+    return;
+  }
+  // Unlinking a node moves nodes around but never their items, so the
+  // next node in key order is still the same node afterwards
+  Node<Key, Value>* node = source.getSmallestNode();
+  while (node != nullptr) {
+    Node<Key, Value>* next = successor(node);
+    if (source.isLive(node)) {
+      Node<Key, Value>* parentNode = nullptr;
+      Node<Key, Value>* currNode = descend(root_, node->getKey(), parentNode);
+      if (currNode == nullptr) {
+        source.unlinkNode(node);
+        source.uncacheNode(node);
+        linkNode(parentNode, node);
+      }
+      else if (!isLive(currNode)) {
+        reviveNode(currNode);
+        updateValue(currNode, node->getValue());
+        source.unlinkNode(node);
+        source.destroyNode(node);
+      }
+    }
+    node = next;
+  }
+}
+
+/**
+* Finds key starting the search at hint, as insert(hint, pair) does.
+* Returns end() if the key is not present.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::findFrom(iterator hint, const Key& key) const {
+  BST_PERF_SCOPE(OP_FIND);
+  BST_TRACE_KEY(EV_FIND, key);
+  Node<Key, Value>* parentNode = nullptr;
+  Node<Key, Value>* found = descend(climbFrom(hint.current_, key), key, parentNode);
+  return iterator(isLive(found) ? found : nullptr);
+}
+
+/**
+* Searches the subtree under start for key. Returns the node holding key,
+* or null with parent set to the node a new key would hang from (null if
+* the subtree is empty). The loop is chosen by BstKeyTraits.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(Node<Key, Value>* start, typename BstKeyTraits<Key>::param_type key, Node<Key, Value>*& parent) const {
+  return BstKeyTraits<Key>::descend(start, key, parent);
+}
+
+/**
+* Climbs from finger to the lowest ancestor (or finger itself) whose
+* subtree must hold key if the tree holds it, and returns it. Climbing
+* toward larger keys, the ancestors that bound the search are the ones
+* reached from their left subtree; ancestors reached from the right are
+* passed without comparing. If the climb reaches the root without finding
+* an upper bound, the search starts from the last bound passed (or from
+* finger itself when finger is on the right spine), so appending after
+* the maximum needs no descent. Returns the root for a null finger.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::climbFrom(Node<Key, Value>* finger, const Key& key) const {
+  if (finger == nullptr) {
+    return root_;
+  }
+  if (key == finger->getKey()) {
+    return finger;
+  }
+  bool toRight = finger->getKey() < key;
+  Node<Key, Value>* start = finger;
+  Node<Key, Value>* currNode = finger;
+  Node<Key, Value>* parentNode = currNode->getParent();
+  while (parentNode != nullptr) {
+    bool fromLeft = (currNode == parentNode->getLeft());
+    if (fromLeft == toRight) {
+      // parentNode bounds currNode's subtree on the side we are heading
+      BST_PERF_COUNT(SW_NODES_VISITED);
+      if (key == parentNode->getKey()) {
+        return parentNode;
+      }
+      if (toRight ? (key < parentNode->getKey()) : (parentNode->getKey() < key)) {
+        return currNode;
+      }
+      start = parentNode;
+    }
+    currNode = parentNode;
+    parentNode = currNode->getParent();
+  }
+  return start;
+}
+
+/**
+* Returns the node with the smallest key not less than key (possibly a
+* tombstone), or null. key may be of any type comparable with Key by
+* operator< in both orders. Makes one comparison per level, with no early
+* exit on an equal key, since for keys such as strings compared against
+* C strings each comparison is the expensive part.
+*/
+template<class Key, class Value>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value>::lowerBoundNode(const K& key) const {
+  Node<Key, Value>* bound = nullptr;
+  Node<Key, Value>* currNode = root_;
+  while (currNode != nullptr) {
+    BST_PERF_COUNT(SW_NODES_VISITED);
+    if (currNode->getKey() < key) {
+      currNode = currNode->getRight();
+    }
+    else {
+      bound = currNode;
+      currNode = currNode->getLeft();
+    }
+  }
+  return bound;
+}
+
+/**
+* Heterogeneous counterpart of internalFind(): the lower bound, if no key
+* orders before it. Equality is taken to be neither key ordering before
+* the other, so K needs no operator==. Returns the node (possibly a
+* tombstone) or null.
+*/
+template<class Key, class Value>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value>::lookup(const K& key) const {
+  BST_PERF_SCOPE(OP_FIND);
+  Node<Key, Value>* bound = lowerBoundNode(key);
+  if (bound != nullptr && key < bound->getKey()) {
+    return nullptr;
+  }
+  return bound;
+}
+
+/**
+* False only for tombstones. Null is live.
+*/
+template<class Key, class Value>
+bool BinarySearchTree<Key, Value>::isLive(Node<Key, Value>* node) const {
+  return node == nullptr || !node->isTombstone();
+}
+
+/**
+* Moves leftmost_ and rightmost_ off node, a live node that is about to
+* be unlinked or marked as a tombstone, to the nearest live nodes.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::moveExtremesOff(Node<Key, Value>* node) {
+  if (node == leftmost_) {
+    leftmost_ = liveNeighbor(node, Node<Key, Value>::RIGHT);
+  }
+  if (node == rightmost_) {
+    rightmost_ = liveNeighbor(node, Node<Key, Value>::LEFT);
+  }
+}
+
+/**
+* Makes node, a node that has just become live, leftmost_ or rightmost_
+* if it lies beyond them. Only needed while the tree holds tombstones:
+* otherwise linkNode() can tell from the parent alone.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::noteExtreme(Node<Key, Value>* node) {
+  if (leftmost_ == nullptr || node->getKey() < leftmost_->getKey()) {
+    leftmost_ = node;
+  }
+  if (rightmost_ == nullptr || rightmost_->getKey() < node->getKey()) {
+    rightmost_ = node;
+  }
+}
+
+/**
+* Brings a tombstone found by an insert back to life; the insert then
+* overwrites its value. Trees whose nodes can be tombstones override this
+* to clear the node's flag and call this version for the counts.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::reviveNode(Node<Key, Value>* node) {
+  --tombstones_;
+  ++size_;
+  noteExtreme(node);
+}
+
+/**
+* Overwrites the value of a node found by an insert. Trees that keep
+* summaries of their values override this to refresh them.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::updateValue(Node<Key, Value>* node, const Value& value) {
+  node->setValue(value);
+}
+
+/**
+* Allocates a node for a new item. Derived trees override this to create
+* their own node type.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::createNode(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent) {
+  return new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+}
+
+/**
+* Creates a node for keyValuePair and links it as a child of parent (or
+* as the root if parent is null), which must be where a search for the
+* key ended. Returns the new node.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::attachNode(Node<Key, Value>* parent, const std::pair<const Key, Value>& keyValuePair) {
+  Node<Key, Value>* newNode = createNode(keyValuePair, parent);
+  linkNode(parent, newNode);
+  return newNode;
+}
+
+/**
+* Links node, new or detached from a tree of the same type, as a leaf
+* under parent (or as the root if parent is null), which must be where a
+* search for its key ended. Every insert goes through here, so balanced
+* trees override this to reset their own node fields first and to
+* rebalance after calling this version.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::linkNode(Node<Key, Value>* parent, Node<Key, Value>* node) {
+  node->setParent(parent);
+  node->setLeft(nullptr);
+  node->setRight(nullptr);
+  if (parent == nullptr) {
+    root_ = node;
+    leftmost_ = node;
+    rightmost_ = node;
+  }
+  else if (node->getKey() < parent->getKey()) {
+    parent->setLeft(node);
+    if (parent == leftmost_) {
+      leftmost_ = node;
+    }
+  }
   else {
-    currNode->setRight(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, currNode));
+    parent->setRight(node);
+    if (parent == rightmost_) {
+      rightmost_ = node;
+    }
+  }
+  if (tombstones_ != 0) {
+    // parent may be a tombstone beyond the live extremes
+    noteExtreme(node);
   }
+  ++size_;
 }
 
 /**
@@ -512,103 +1455,140 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key) {
   // TODO
+  BST_PERF_SCOPE(OP_REMOVE);
+  BST_TRACE_KEY(EV_REMOVE, key);
   Node<Key, Value>* currNode = internalFind(key);
+  if (currNode != nullptr && isLive(currNode)) {
+    removeNode(currNode);
+  }
+}
 
-  if (currNode == nullptr)
-    return;
+/**
+* Removes node, a live node found by a search, from the tree and deletes
+* it. Both remove() overloads end here; trees that can remove without
+* unlinking (lazily) override this.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* node) {
+  unlinkNode(node);
+  destroyNode(node);
+}
 
+/**
+* Moves leftmost_ and rightmost_ off node, then detaches it. Everything
+* that takes a node out of the tree goes through here.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::unlinkNode(Node<Key, Value>* node) {
+  moveExtremesOff(node);
+  detachNode(node);
+}
+
+/**
+* Unlinks node, a live node, from the tree without deleting it. remove()
+* and extract() both end here, so balanced trees override this to
+* rebalance.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::detachNode(Node<Key, Value>* currNode) {
   // 2 Children
   if (currNode->getLeft() != nullptr && currNode->getRight() != nullptr) {
     nodeSwap(currNode, predecessor(currNode));
   }
 
+  // 0 or 1 Children: splice the child (if any) into currNode's place
   Node<Key, Value>* parentNode = currNode->getParent();
-  // 0 Children (Leaf Node)
-  if (currNode->getLeft() == nullptr && currNode->getRight() == nullptr) {
-    if (currNode == parentNode->getLeft()) {
-      parentNode->setLeft(nullptr);
-    }
-    else {
-      parentNode->setRight(nullptr);
-    }
-    delete currNode;
+  Node<Key, Value>* child = (currNode->getLeft() != nullptr) ? currNode->getLeft() : currNode->getRight();
+  if (child != nullptr) {
+    child->setParent(parentNode);
   }
-  // 1 Child (Left)
-  else if (currNode->getRight() == nullptr) {
-    if (currNode == parentNode->getLeft()) {
-      parentNode->setLeft(currNode->getLeft());
-    }
-    else {
-      parentNode->setRight(currNode->getLeft());
-    }
-    delete currNode;
+  if (parentNode == nullptr) {
+    root_ = child;
+  }
+  else if (currNode == parentNode->getLeft()) {
+    parentNode->setLeft(child);
   }
-  // 1 Child (Right)
   else {
-    if (currNode == parentNode->getLeft()) {
-      parentNode->setLeft(currNode->getRight());
-    }
-    else {
-      parentNode->setRight(currNode->getRight());
-    }
-    delete currNode;
+    parentNode->setRight(child);
   }
+  --size_;
 }
 
 template<class Key, class Value>
 Node<Key, Value>*
 BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current) {
   // TODO
-  if (current == nullptr)
-    return nullptr;
+  return neighbor(current, Node<Key, Value>::LEFT);
+}
 
-  if (current->getLeft() != nullptr) {
-    Node<Key, Value>* currNode = current->getLeft();
-    while (currNode->getRight() != nullptr) {
-      currNode = currNode->getRight();
-    }
-    return currNode;
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current) {
+  // TODO
+  return neighbor(current, Node<Key, Value>::RIGHT);
+}
+
+/**
+* Rotates node down in direction dir (a left rotation for LEFT), lifting
+* its child on the other side into its place, and returns that child.
+* Fixes every parent and child link and counts the rotation; balanced
+* trees wrap this to update their own node fields.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::rotate(Node<Key, Value>* node, bool dir) {
+  BST_PERF_COUNT(SW_ROTATIONS);
+  if (dir == Node<Key, Value>::LEFT) {
+    ++leftRotations_;
   }
   else {
-    Node<Key, Value>* currNode = current;
-    while (currNode->getParent() != nullptr && currNode->getParent()->getRight() != currNode) {
-      currNode = currNode->getParent();
-    }
-    if (currNode->getParent() == nullptr) {
-      return (currNode->getKey() < current->getKey()) ? currNode : nullptr;
-    }
-    else {
-      return currNode->getParent();
-    }
+    ++rightRotations_;
+  }
+  Node<Key, Value>* riser = node->getChild(!dir);
+  Node<Key, Value>* parentNode = node->getParent();
+  riser->setParent(parentNode);
+  if (parentNode == nullptr) {
+    root_ = riser;
   }
+  else {
+    parentNode->setChild(parentNode->getChild(Node<Key, Value>::RIGHT) == node, riser);
+  }
+
+  Node<Key, Value>* inner = riser->getChild(dir);
+  node->setChild(!dir, inner);
+  if (inner != nullptr) {
+    inner->setParent(node);
+  }
+  riser->setChild(dir, node);
+  node->setParent(riser);
+  return riser;
 }
 
+/**
+* The in-order neighbor of current in direction dir: the successor for
+* RIGHT, the predecessor for LEFT. Null if there is none.
+*/
 template<class Key, class Value>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current) {
-  // TODO
+BinarySearchTree<Key, Value>::neighbor(Node<Key, Value>* current, bool dir) {
   if (current == nullptr)
     return nullptr;
 
-  if (current->getRight() != nullptr) {
-    Node<Key, Value>* currNode = current->getRight();
-    while (currNode->getLeft() != nullptr) {
-      currNode = currNode->getLeft();
+  Node<Key, Value>* currNode = current->getChild(dir);
+  if (currNode != nullptr) {
+    while (currNode->getChild(!dir) != nullptr) {
+      currNode = currNode->getChild(!dir);
     }
     return currNode;
   }
-  else {
-    Node<Key, Value>* currNode = current;
-    while (currNode->getParent() != nullptr && currNode->getParent()->getLeft() != currNode) {
-      currNode = currNode->getParent();
-    }
-    if (currNode->getParent() == nullptr) {
-      return (currNode->getKey() > current->getKey()) ? currNode : nullptr;
-    }
-    else {
-      return currNode->getParent();
-    }
+  // Climb until we come up from the !dir side of a parent
+  currNode = current;
+  Node<Key, Value>* parentNode = currNode->getParent();
+  while (parentNode != nullptr && parentNode->getChild(dir) == currNode) {
+    currNode = parentNode;
+    parentNode = currNode->getParent();
   }
+  return parentNode;
 }
 
 
@@ -618,30 +1598,56 @@ BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current) {
 */
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::clear() {
-  if (root_ == nullptr)
-    return;
-  dfs(root_, [](Node<Key, Value>* node) {
-    node->setLeft(nullptr);
-    node->setRight(nullptr);
-    node->setParent(nullptr);
+  // Iterative so that clearing a degenerate (list-shaped) tree cannot
+  // overflow the call stack.
+  std::vector<Node<Key, Value>*> stack;
+  if (root_ != nullptr) {
+    // Destroying a non-empty tree is recorded as a clear too
+    BST_TRACE_EVENT(EV_CLEAR);
+    stack.push_back(root_);
+  }
+  while (!stack.empty()) {
+    Node<Key, Value>* node = stack.back();
+    stack.pop_back();
+    if (node->getLeft() != nullptr) {
+      stack.push_back(node->getLeft());
+    }
+    if (node->getRight() != nullptr) {
+      stack.push_back(node->getRight());
+    }
     delete node;
-  });
-  // root_ = nullptr;
+  }
+  std::fill(cache_.begin(), cache_.end(), (Node<Key, Value>*)nullptr);
+  root_ = nullptr;
+  leftmost_ = nullptr;
+  rightmost_ = nullptr;
+  size_ = 0;
+  tombstones_ = 0;
 }
 
 
 /**
-* A helper function to find the smallest node in the tree.
+* A helper function to find the live node with the smallest key, or null
+* if there is none.
 */
 template<typename Key, typename Value>
 Node<Key, Value>*
 BinarySearchTree<Key, Value>::getSmallestNode() const {
   // TODO
-  Node<Key, Value>* currNode = root_;
-  while (currNode->getLeft() != nullptr) {
-    currNode = currNode->getLeft();
-  }
-  return currNode;
+  return leftmost_;
+}
+
+/**
+* The nearest live node after node in direction dir (RIGHT for larger
+* keys), or null. Tombstones are skipped only while the tree holds any.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::liveNeighbor(Node<Key, Value>* node, bool dir) const {
+  do {
+    node = neighbor(node, dir);
+  } while (tombstones_ != 0 && node != nullptr && node->isTombstone());
+  return node;
 }
 
 /**
@@ -650,18 +1656,354 @@ BinarySearchTree<Key, Value>::getSmallestNode() const {
 * exists
 */
 template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const {
+Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(typename BstKeyTraits<Key>::param_type key) const {
   // TODO
-  Node<Key, Value>* currNode = root_;
-  while (currNode != nullptr && currNode->getKey() != key) {
-    if (key < currNode->getKey()) {
-      currNode = currNode->getLeft();
+  BST_PERF_SCOPE(OP_FIND);
+  Node<Key, Value>* parentNode = nullptr;
+  return BstKeyTraits<Key>::descend(root_, key, parentNode);
+}
+
+/**
+* Turns on a cache of recently found nodes, consulted by find() and
+* operator[] before descending from the root. slots is rounded up to a
+* power of two (at least 2); 0 turns the cache off. A hit costs one hash
+* and one or two key comparisons. Has no effect for keys without
+* std::hash.
+*
+* The cache is two-way set associative: each key hashes to a set of two
+* entries, and a miss evicts the less recently found one. That keeps two
+* hot keys that share a set both cached, which a direct-mapped table of
+* the same size cannot; even so, expect a good hit rate only with slots
+* at least twice the number of hot keys.
+*
+* Because const lookups fill the cache, concurrent const lookups on a
+* tree with the cache enabled are not thread-safe.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableLookupCache(size_t slots) {
+  cache_.clear();
+  cacheShift_ = 64;
+  if (slots == 0 || !BstKeyHash<Key>::enabled) {
+    return;
+  }
+  size_t capacity = 2;
+  while (capacity < slots) {
+    capacity <<= 1;
+    --cacheShift_;
+  }
+  cache_.assign(capacity, nullptr);
+}
+
+/**
+* The first entry of key's set in the cache. Uses Fibonacci hashing so
+* that hashes which are identities (as for integers) still spread over
+* the table. The product is taken in 64 bits whatever the width of
+* size_t, and a single set (cacheShift_ == 64) is returned without
+* shifting, since shifting a 64-bit value by 64 is undefined.
+*/
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::cacheSlot(const Key& key) const {
+  if (cacheShift_ >= 64) {
+    return 0;
+  }
+  uint64_t hash = (uint64_t)BstKeyHash<Key>::hash(key) * 11400714819323198485ull;
+  return 2 * (size_t)(hash >> cacheShift_);
+}
+
+/**
+* internalFind() through the lookup cache. A miss descends and remembers
+* the node found.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cachedFind(const Key& key) const {
+  if (cache_.empty()) {
+    Node<Key, Value>* found = internalFind(key);
+    return isLive(found) ? found : nullptr;
+  }
+  size_t slot = cacheSlot(key);
+  Node<Key, Value>* node = cache_[slot];
+  if (node != nullptr && node->getKey() == key) {
+    return isLive(node) ? node : nullptr;
+  }
+  node = cache_[slot + 1];
+  if (node != nullptr && node->getKey() == key) {
+    // Move it to the front of its set
+    cache_[slot + 1] = cache_[slot];
+    cache_[slot] = node;
+    return isLive(node) ? node : nullptr;
+  }
+  node = internalFind(key);
+  if (node != nullptr) {
+    cache_[slot + 1] = cache_[slot];
+    cache_[slot] = node;
+  }
+  return isLive(node) ? node : nullptr;
+}
+
+/**
+* Drops node from the lookup cache. Every node that leaves the tree, by
+* remove() or extract(), goes through here. nodeSwap() and the rotations
+* move nodes but never their items, so they leave cached entries valid.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::uncacheNode(Node<Key, Value>* node) {
+  if (!cache_.empty()) {
+    size_t slot = cacheSlot(node->getKey());
+    if (cache_[slot] == node) {
+      cache_[slot] = cache_[slot + 1];
+      cache_[slot + 1] = nullptr;
     }
-    else {
-      currNode = currNode->getRight();
+    else if (cache_[slot + 1] == node) {
+      cache_[slot + 1] = nullptr;
+    }
+  }
+}
+
+/**
+* Exchanges the contents of two trees in O(1), settings included.
+* Iterators stay valid and follow their items. other must have the same
+* type as this tree, or std::invalid_argument is thrown; trees with
+* settings of their own override this to swap those too.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::swap(BinarySearchTree<Key, Value>& other) {
+  checkOwner(typeid(other));
+  swapMembers(other);
+}
+
+/**
+* Swaps the members declared in this class.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::swapMembers(BinarySearchTree<Key, Value>& other) {
+  std::swap(root_, other.root_);
+  std::swap(leftmost_, other.leftmost_);
+  std::swap(rightmost_, other.rightmost_);
+  std::swap(size_, other.size_);
+  std::swap(leftRotations_, other.leftRotations_);
+  std::swap(rightRotations_, other.rightRotations_);
+  cache_.swap(other.cache_);
+  std::swap(cacheShift_, other.cacheShift_);
+  std::swap(tombstones_, other.tombstones_);
+}
+
+/**
+* Builds a copy of other's nodes for the copy constructor, parents
+* before children, with an explicit stack so that a degenerate tree
+* cannot overflow the call stack. Each copy is linked in as soon as it is
+* made, so if one throws, clear() can free the partial tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::cloneNodes(const BinarySearchTree<Key, Value>& other) {
+  if (other.root_ == nullptr) {
+    return;
+  }
+  // Pairs of an original node and its copy, whose children are still to do
+  std::vector<std::pair<Node<Key, Value>*, Node<Key, Value>*> > stack;
+  try {
+    root_ = other.root_->clone();
+    root_->setParent(nullptr);
+    root_->setLeft(nullptr);
+    root_->setRight(nullptr);
+    if (other.root_ == other.leftmost_) {
+      leftmost_ = root_;
+    }
+    if (other.root_ == other.rightmost_) {
+      rightmost_ = root_;
+    }
+    stack.push_back(std::make_pair(other.root_, root_));
+    while (!stack.empty()) {
+      Node<Key, Value>* original = stack.back().first;
+      Node<Key, Value>* copy = stack.back().second;
+      stack.pop_back();
+      for (int dir = Node<Key, Value>::LEFT; dir <= Node<Key, Value>::RIGHT; ++dir) {
+        Node<Key, Value>* child = original->getChild(dir);
+        if (child == nullptr) {
+          continue;
+        }
+        Node<Key, Value>* childCopy = child->clone();
+        childCopy->setParent(copy);
+        childCopy->setLeft(nullptr);
+        childCopy->setRight(nullptr);
+        copy->setChild(dir, childCopy);
+        if (child == other.leftmost_) {
+          leftmost_ = childCopy;
+        }
+        if (child == other.rightmost_) {
+          rightmost_ = childCopy;
+        }
+        stack.push_back(std::make_pair(child, childCopy));
+      }
+    }
+  }
+  catch (...) {
+    clear();
+    throw;
+  }
+}
+
+/**
+* Unlinks node, a live node, and wraps it in a handle tagged with this
+* tree's type. Its links are left stale: the handle never follows them,
+* and linkNode() resets them when the node is inserted again.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::node_type
+BinarySearchTree<Key, Value>::extractNode(Node<Key, Value>* node) {
+  unlinkNode(node);
+  uncacheNode(node);
+  return node_type(node, &typeid(*this));
+}
+
+/**
+* Throws std::invalid_argument unless owner, the type of the tree a node
+* came from, is this tree's type. Trees of different types may use
+* different node classes, so their nodes cannot be exchanged.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::checkOwner(const std::type_info& owner) const {
+  // type_info objects are usually unique, so the address test settles
+  // the common case without comparing names
+  if (&owner != &typeid(*this) && owner != typeid(*this)) {
+    throw std::invalid_argument("Node comes from a tree of another type");
+  }
+}
+
+/**
+* Deletes a node that has already been unlinked, first dropping it from
+* the lookup cache.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::destroyNode(Node<Key, Value>* node) {
+  uncacheNode(node);
+  delete node;
+}
+
+/**
+ * Returns the size of one node, used to report the memory held by the tree.
+ */
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::nodeBytes() const {
+  return sizeof(Node<Key, Value>);
+}
+
+/**
+ * Returns a snapshot of the tree's shape. The node count and rotation
+ * counters are maintained as the tree changes; the depth fields take one
+ * iterative pass over the nodes, so this is safe on degenerate trees.
+ * Bytes used counts the nodes only, not memory owned by keys or values.
+ */
+template<typename Key, typename Value>
+TreeStats BinarySearchTree<Key, Value>::stats() const {
+  TreeStats result;
+  // Tombstones still take up nodes and depth
+  size_t linked = size_ + tombstones_;
+  result.nodeCount = size_;
+  result.height = 0;
+  result.averageDepth = 0.0;
+  result.leftRotations = leftRotations_;
+  result.rightRotations = rightRotations_;
+  result.bytesUsed = linked * nodeBytes();
+
+  std::vector<std::pair<Node<Key, Value>*, int> > stack;
+  if (root_ != nullptr) {
+    stack.push_back(std::make_pair(root_, 1));
+  }
+  size_t depthSum = 0;
+  while (!stack.empty()) {
+    Node<Key, Value>* node = stack.back().first;
+    int depth = stack.back().second;
+    stack.pop_back();
+
+    if (depth > result.height) {
+      result.height = depth;
+      result.depthHistogram.resize(depth, 0);
+    }
+    ++result.depthHistogram[depth - 1];
+    depthSum += depth;
+
+    if (node->getLeft() != nullptr) {
+      stack.push_back(std::make_pair(node->getLeft(), depth + 1));
+    }
+    if (node->getRight() != nullptr) {
+      stack.push_back(std::make_pair(node->getRight(), depth + 1));
+    }
+  }
+  if (linked > 0) {
+    result.averageDepth = (double)depthSum / linked;
+  }
+  return result;
+}
+
+/**
+ * Visits every node after both of its subtrees, without recursion, and
+ * passes check(node, leftSummary, rightSummary). Stops as soon as check
+ * returns false. Returns the height of the tree, or -1 if a check failed.
+ */
+template<typename Key, typename Value>
+template<typename Check>
+int BinarySearchTree<Key, Value>::checkSubtrees(Check check) const {
+  // Each stack entry is a node plus whether its children have been pushed.
+  // Finished subtrees leave their summary on the summaries stack, left
+  // subtree below right subtree.
+  std::vector<std::pair<Node<Key, Value>*, bool> > stack;
+  std::vector<SubtreeSummary> summaries;
+  if (root_ != nullptr) {
+    stack.push_back(std::make_pair(root_, false));
+  }
+  while (!stack.empty()) {
+    Node<Key, Value>* node = stack.back().first;
+    if (!stack.back().second) {
+      stack.back().second = true;
+      if (node->getRight() != nullptr) {
+        stack.push_back(std::make_pair(node->getRight(), false));
+      }
+      if (node->getLeft() != nullptr) {
+        stack.push_back(std::make_pair(node->getLeft(), false));
+      }
+      continue;
     }
+    stack.pop_back();
+
+    SubtreeSummary left = { 0, nullptr, nullptr };
+    SubtreeSummary right = { 0, nullptr, nullptr };
+    if (node->getRight() != nullptr) {
+      right = summaries.back();
+      summaries.pop_back();
+    }
+    if (node->getLeft() != nullptr) {
+      left = summaries.back();
+      summaries.pop_back();
+    }
+    if (!check(node, left, right)) {
+      return -1;
+    }
+    SubtreeSummary merged;
+    merged.height = std::max(left.height, right.height) + 1;
+    merged.min = (left.min != nullptr) ? left.min : node;
+    merged.max = (right.max != nullptr) ? right.max : node;
+    summaries.push_back(merged);
   }
-  return currNode;
+  return summaries.empty() ? 0 : summaries.back().height;
+}
+
+/**
+ * Hook for subclasses to check their own per-node invariants during
+ * validate(). The plain BST has none.
+ */
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::checkNode(Node<Key, Value>*, int, int) const {
+  return true;
+}
+
+/**
+ * Returns the number of levels in the tree (0 when empty) in O(n).
+ */
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::height() const {
+  return checkSubtrees([](Node<Key, Value>*, const SubtreeSummary&, const SubtreeSummary&) {
+    return true;
+  });
 }
 
 /**
@@ -670,7 +2012,61 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
 template<typename Key, typename Value>
 bool BinarySearchTree<Key, Value>::isBalanced() const {
   // TODO
-  return isTreeBalanced(root_);
+  return checkSubtrees([](Node<Key, Value>*, const SubtreeSummary& left, const SubtreeSummary& right) {
+    return std::abs(left.height - right.height) <= 1;
+  }) >= 0;
+}
+
+/**
+ * Checks the structure of the whole tree in one O(n) pass: keys are in
+ * order, every child points back at its parent, the live and tombstone
+ * node counts match size() and the tombstone count, and every node
+ * passes checkNode(), through which derived trees add their own per-node
+ * invariants (balance factors, red-black colors).
+ */
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::validate() const {
+  if (root_ != nullptr && root_->getParent() != nullptr) {
+    return false;
+  }
+  size_t count = 0;
+  size_t dead = 0;
+  int h = checkSubtrees([this, &count, &dead](Node<Key, Value>* node, const SubtreeSummary& left, const SubtreeSummary& right) {
+    ++count;
+    if (node->isTombstone()) {
+      ++dead;
+    }
+    if (node->getLeft() != nullptr && node->getLeft()->getParent() != node) {
+      return false;
+    }
+    if (node->getRight() != nullptr && node->getRight()->getParent() != node) {
+      return false;
+    }
+    if (left.max != nullptr && !(left.max->getKey() < node->getKey())) {
+      return false;
+    }
+    if (right.min != nullptr && !(node->getKey() < right.min->getKey())) {
+      return false;
+    }
+    return checkNode(node, left.height, right.height);
+  });
+  Node<Key, Value>* first = root_;
+  Node<Key, Value>* last = root_;
+  while (first != nullptr && first->getLeft() != nullptr) {
+    first = first->getLeft();
+  }
+  while (last != nullptr && last->getRight() != nullptr) {
+    last = last->getRight();
+  }
+  // The extremes are the first and last live nodes
+  while (first != nullptr && first->isTombstone()) {
+    first = successor(first);
+  }
+  while (last != nullptr && last->isTombstone()) {
+    last = predecessor(last);
+  }
+  return h >= 0 && count == size_ + tombstones_ && dead == tombstones_
+      && first == leftmost_ && last == rightmost_;
 }
 
 
@@ -681,6 +2077,7 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    BST_PERF_COUNT(SW_NODE_SWAPS);
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
@@ -0,0 +1,711 @@
+#ifndef COMPACT_AVL_H
+#define COMPACT_AVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+/**
+* A node of a CompactAVLTree. Instead of a vtable and three 64-bit pointers
+* (see Node and AVLNode) it stores its children as 32-bit indices into the
+* tree's node pool, and packs the parent index together with the two-bit
+* balance into one more 32-bit word:
+*
+*     parentBalance_ = (parent index << 2) | (balance + 1)
+*
+* so a CompactAVLNode<int, int> is 20 bytes instead of 48.
+*/
+template <typename Key, typename Value>
+struct CompactAVLNode
+{
+    CompactAVLNode(const Key& key, const Value& value, uint32_t parent);
+
+    uint32_t getParent() const;
+    int8_t getBalance() const;
+    void setParent(uint32_t parent);
+    void setBalance(int8_t balance);
+
+    std::pair<const Key, Value> item_;
+    uint32_t left_;
+    uint32_t right_;
+    uint32_t parentBalance_;
+};
+
+/**
+* An AVL tree with the same interface as AVLTree, whose nodes live in one
+* contiguous pool and refer to each other by 32-bit index. It holds up to
+* CompactAVLTree::MAX_SIZE (about 10^9) items.
+*
+* Removing a node moves the last node of the pool into the freed slot, so
+* the pool never has holes. As with std::vector, any insert or remove
+* invalidates existing iterators.
+*/
+template <typename Key, typename Value>
+class CompactAVLTree
+{
+public:
+    typedef CompactAVLNode<Key, Value> NodeType;
+
+    // Index meaning "no node". It fits in the 30 bits left for the parent.
+    static const uint32_t NIL = 0x3FFFFFFF;
+    static const size_t MAX_SIZE = NIL;
+
+    CompactAVLTree();
+
+    void insert(const std::pair<const Key, Value>& new_item);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    int height() const;
+    bool isBalanced() const;
+    bool validate() const;
+    void reserve(size_t n);
+    void shrinkToFit();
+    size_t bytesUsed() const;
+
+    /**
+    * An iterator over the items in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key, Value>& operator*() const;
+        std::pair<const Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value>;
+        iterator(CompactAVLTree<Key, Value>* tree, uint32_t index);
+        CompactAVLTree<Key, Value>* tree_;
+        uint32_t current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    uint32_t internalFind(const Key& key) const;
+    uint32_t successor(uint32_t current) const;
+    uint32_t predecessor(uint32_t current) const;
+    void replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild);
+    void leftRotation(uint32_t startingNode);
+    void rightRotation(uint32_t startingNode);
+    void releaseSlot(uint32_t index);
+
+    std::vector<NodeType> pool_;
+    uint32_t root_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLNode class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+CompactAVLNode<Key, Value>::CompactAVLNode(const Key& key, const Value& value, uint32_t parent) :
+    item_(key, value),
+    left_(CompactAVLTree<Key, Value>::NIL),
+    right_(CompactAVLTree<Key, Value>::NIL),
+    parentBalance_((parent << 2) | 1)
+{
+
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLNode<Key, Value>::getParent() const
+{
+    return parentBalance_ >> 2;
+}
+
+template<typename Key, typename Value>
+int8_t CompactAVLNode<Key, Value>::getBalance() const
+{
+    return (int8_t)(parentBalance_ & 3) - 1;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setParent(uint32_t parent)
+{
+    parentBalance_ = (parent << 2) | (parentBalance_ & 3);
+}
+
+/**
+* Stores a balance in [-1, 1]. During rebalancing a node may briefly be
+* at +/-2; those states are never stored, the callers keep them in locals.
+*/
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    parentBalance_ = (parentBalance_ & ~3u) | (uint32_t)(balance + 1);
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+CompactAVLTree<Key, Value>::iterator::iterator() :
+    tree_(nullptr), current_(NIL)
+{
+
+}
+
+template<typename Key, typename Value>
+CompactAVLTree<Key, Value>::iterator::iterator(CompactAVLTree<Key, Value>* tree, uint32_t index) :
+    tree_(tree), current_(index)
+{
+
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& CompactAVLTree<Key, Value>::iterator::operator*() const
+{
+    return tree_->pool_[current_].item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>* CompactAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(tree_->pool_[current_].item_);
+}
+
+template<typename Key, typename Value>
+bool CompactAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<typename Key, typename Value>
+bool CompactAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<typename Key, typename Value>
+typename CompactAVLTree<Key, Value>::iterator&
+CompactAVLTree<Key, Value>::iterator::operator++()
+{
+    current_ = tree_->successor(current_);
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLTree class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+const uint32_t CompactAVLTree<Key, Value>::NIL;
+
+template<typename Key, typename Value>
+const size_t CompactAVLTree<Key, Value>::MAX_SIZE;
+
+template<typename Key, typename Value>
+CompactAVLTree<Key, Value>::CompactAVLTree() :
+    root_(NIL)
+{
+
+}
+
+template<typename Key, typename Value>
+bool CompactAVLTree<Key, Value>::empty() const
+{
+    return root_ == NIL;
+}
+
+template<typename Key, typename Value>
+size_t CompactAVLTree<Key, Value>::size() const
+{
+    return pool_.size();
+}
+
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::clear()
+{
+    pool_.clear();
+    root_ = NIL;
+}
+
+/**
+* Pre-sizes the node pool, avoiding the slack left by vector growth.
+*/
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::reserve(size_t n)
+{
+    pool_.reserve(n);
+}
+
+/**
+* Returns unused pool capacity to the allocator.
+*/
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::shrinkToFit()
+{
+    pool_.shrink_to_fit();
+}
+
+/**
+* Bytes held by the node pool, including unused capacity.
+*/
+template<typename Key, typename Value>
+size_t CompactAVLTree<Key, Value>::bytesUsed() const
+{
+    return pool_.capacity() * sizeof(NodeType);
+}
+
+template<typename Key, typename Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::begin() const
+{
+    uint32_t curr = root_;
+    while (curr != NIL && pool_[curr].left_ != NIL) {
+        curr = pool_[curr].left_;
+    }
+    return iterator(const_cast<CompactAVLTree<Key, Value>*>(this), curr);
+}
+
+template<typename Key, typename Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::end() const
+{
+    return iterator(const_cast<CompactAVLTree<Key, Value>*>(this), NIL);
+}
+
+template<typename Key, typename Value>
+typename CompactAVLTree<Key, Value>::iterator
+CompactAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(const_cast<CompactAVLTree<Key, Value>*>(this), internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Key, typename Value>
+Value& CompactAVLTree<Key, Value>::operator[](const Key& key)
+{
+    uint32_t curr = internalFind(key);
+    if (curr == NIL) throw std::out_of_range("Invalid key");
+    return pool_[curr].item_.second;
+}
+
+template<typename Key, typename Value>
+Value const & CompactAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    uint32_t curr = internalFind(key);
+    if (curr == NIL) throw std::out_of_range("Invalid key");
+    return pool_[curr].item_.second;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    uint32_t curr = root_;
+    while (curr != NIL) {
+        const Key& currKey = pool_[curr].item_.first;
+        if (key < currKey) {
+            curr = pool_[curr].left_;
+        } else if (currKey < key) {
+            curr = pool_[curr].right_;
+        } else {
+            break;
+        }
+    }
+    return curr;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLTree<Key, Value>::successor(uint32_t current) const
+{
+    if (current == NIL) {
+        return NIL;
+    }
+    if (pool_[current].right_ != NIL) {
+        current = pool_[current].right_;
+        while (pool_[current].left_ != NIL) {
+            current = pool_[current].left_;
+        }
+        return current;
+    }
+    uint32_t parent = pool_[current].getParent();
+    while (parent != NIL && pool_[parent].right_ == current) {
+        current = parent;
+        parent = pool_[parent].getParent();
+    }
+    return parent;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLTree<Key, Value>::predecessor(uint32_t current) const
+{
+    if (current == NIL) {
+        return NIL;
+    }
+    if (pool_[current].left_ != NIL) {
+        current = pool_[current].left_;
+        while (pool_[current].right_ != NIL) {
+            current = pool_[current].right_;
+        }
+        return current;
+    }
+    uint32_t parent = pool_[current].getParent();
+    while (parent != NIL && pool_[parent].left_ == current) {
+        current = parent;
+        parent = pool_[parent].getParent();
+    }
+    return parent;
+}
+
+/**
+* Points parent (or root_, if parent is NIL) at newChild instead of oldChild.
+*/
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+{
+    if (parent == NIL) {
+        root_ = newChild;
+    } else if (pool_[parent].left_ == oldChild) {
+        pool_[parent].left_ = newChild;
+    } else {
+        pool_[parent].right_ = newChild;
+    }
+}
+
+/**
+* Rotates startingNode down to the left. Balances are not touched; the
+* callers know the resulting balances from the rebalancing case.
+*/
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::leftRotation(uint32_t startingNode)
+{
+    uint32_t rightChild = pool_[startingNode].right_;
+    uint32_t parent = pool_[startingNode].getParent();
+    replaceChild(parent, startingNode, rightChild);
+    pool_[rightChild].setParent(parent);
+
+    uint32_t inner = pool_[rightChild].left_;
+    pool_[startingNode].right_ = inner;
+    if (inner != NIL) {
+        pool_[inner].setParent(startingNode);
+    }
+    pool_[rightChild].left_ = startingNode;
+    pool_[startingNode].setParent(rightChild);
+}
+
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::rightRotation(uint32_t startingNode)
+{
+    uint32_t leftChild = pool_[startingNode].left_;
+    uint32_t parent = pool_[startingNode].getParent();
+    replaceChild(parent, startingNode, leftChild);
+    pool_[leftChild].setParent(parent);
+
+    uint32_t inner = pool_[leftChild].right_;
+    pool_[startingNode].left_ = inner;
+    if (inner != NIL) {
+        pool_[inner].setParent(startingNode);
+    }
+    pool_[leftChild].right_ = startingNode;
+    pool_[startingNode].setParent(leftChild);
+}
+
+/*
+ * If key is already in the tree, the value is overwritten.
+ *
+ * Rebalancing follows AVLTree::insert. Since a stored balance cannot be
+ * +/-2, the rotation cases compute the final balances directly from the
+ * heavy child (and grandchild, for a double rotation).
+ */
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    uint32_t parent = NIL;
+    uint32_t curr = root_;
+    bool goLeft = false;
+    while (curr != NIL) {
+        const Key& currKey = pool_[curr].item_.first;
+        if (new_item.first < currKey) {
+            goLeft = true;
+        } else if (currKey < new_item.first) {
+            goLeft = false;
+        } else {
+            pool_[curr].item_.second = new_item.second;
+            return;
+        }
+        parent = curr;
+        curr = goLeft ? pool_[curr].left_ : pool_[curr].right_;
+    }
+
+    if (pool_.size() >= MAX_SIZE) {
+        throw std::length_error("CompactAVLTree is full");
+    }
+    uint32_t newNode = (uint32_t)pool_.size();
+    pool_.push_back(NodeType(new_item.first, new_item.second, parent));
+    if (parent == NIL) {
+        root_ = newNode;
+        return;
+    } else if (goLeft) {
+        pool_[parent].left_ = newNode;
+    } else {
+        pool_[parent].right_ = newNode;
+    }
+
+    curr = newNode;
+    while (parent != NIL) {
+        int8_t balance = pool_[parent].getBalance() + (curr == pool_[parent].left_ ? -1 : 1);
+
+        if (balance == 0) {
+            pool_[parent].setBalance(0);
+            break;
+        } else if (balance == -2) {
+            if (pool_[curr].getBalance() == 1) {
+                // Left-right case: the grandchild becomes the subtree root
+                uint32_t grand = pool_[curr].right_;
+                int8_t g = pool_[grand].getBalance();
+                leftRotation(curr);
+                rightRotation(parent);
+                pool_[curr].setBalance(g == 1 ? -1 : 0);
+                pool_[parent].setBalance(g == -1 ? 1 : 0);
+                pool_[grand].setBalance(0);
+            } else {
+                rightRotation(parent);
+                pool_[curr].setBalance(0);
+                pool_[parent].setBalance(0);
+            }
+            break;
+        } else if (balance == 2) {
+            if (pool_[curr].getBalance() == -1) {
+                // Right-left case
+                uint32_t grand = pool_[curr].left_;
+                int8_t g = pool_[grand].getBalance();
+                rightRotation(curr);
+                leftRotation(parent);
+                pool_[curr].setBalance(g == -1 ? 1 : 0);
+                pool_[parent].setBalance(g == 1 ? -1 : 0);
+                pool_[grand].setBalance(0);
+            } else {
+                leftRotation(parent);
+                pool_[curr].setBalance(0);
+                pool_[parent].setBalance(0);
+            }
+            break;
+        }
+
+        pool_[parent].setBalance(balance);
+        curr = parent;
+        parent = pool_[parent].getParent();
+    }
+}
+
+/*
+ * A node with two children takes over its predecessor's item, and the
+ * predecessor's node (which has at most one child) is the one unlinked.
+ */
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::remove(const Key& key)
+{
+    uint32_t curr = internalFind(key);
+    if (curr == NIL) {
+        return;
+    }
+
+    if (pool_[curr].left_ != NIL && pool_[curr].right_ != NIL) {
+        uint32_t pred = predecessor(curr);
+        typedef std::pair<const Key, Value> Item;
+        pool_[curr].item_.~Item();
+        ::new (&pool_[curr].item_) Item(std::move(pool_[pred].item_));
+        curr = pred;
+    }
+
+    uint32_t parent = pool_[curr].getParent();
+    uint32_t child = (pool_[curr].left_ != NIL) ? pool_[curr].left_ : pool_[curr].right_;
+    bool isLeftChild = (parent != NIL && pool_[parent].left_ == curr);
+    replaceChild(parent, curr, child);
+    if (child != NIL) {
+        pool_[child].setParent(parent);
+    }
+
+    // Walk up while the subtree we came from got shorter
+    while (parent != NIL) {
+        int8_t balance = pool_[parent].getBalance() + (isLeftChild ? 1 : -1);
+        uint32_t subtreeRoot = parent;
+
+        if (balance == 1 || balance == -1) {
+            pool_[parent].setBalance(balance);
+            break;
+        } else if (balance == 2) {
+            uint32_t right = pool_[parent].right_;
+            int8_t r = pool_[right].getBalance();
+            if (r == -1) {
+                uint32_t grand = pool_[right].left_;
+                int8_t g = pool_[grand].getBalance();
+                rightRotation(right);
+                leftRotation(parent);
+                pool_[parent].setBalance(g == 1 ? -1 : 0);
+                pool_[right].setBalance(g == -1 ? 1 : 0);
+                pool_[grand].setBalance(0);
+                subtreeRoot = grand;
+            } else {
+                leftRotation(parent);
+                pool_[parent].setBalance(r == 0 ? 1 : 0);
+                pool_[right].setBalance(r == 0 ? -1 : 0);
+                subtreeRoot = right;
+            }
+        } else if (balance == -2) {
+            uint32_t left = pool_[parent].left_;
+            int8_t l = pool_[left].getBalance();
+            if (l == 1) {
+                uint32_t grand = pool_[left].right_;
+                int8_t g = pool_[grand].getBalance();
+                leftRotation(left);
+                rightRotation(parent);
+                pool_[parent].setBalance(g == -1 ? 1 : 0);
+                pool_[left].setBalance(g == 1 ? -1 : 0);
+                pool_[grand].setBalance(0);
+                subtreeRoot = grand;
+            } else {
+                rightRotation(parent);
+                pool_[parent].setBalance(l == 0 ? -1 : 0);
+                pool_[left].setBalance(l == 0 ? 1 : 0);
+                subtreeRoot = left;
+            }
+        } else {
+            pool_[parent].setBalance(0);
+        }
+
+        if (pool_[subtreeRoot].getBalance() != 0) {
+            break; // Rotated subtree kept its height
+        }
+        uint32_t up = pool_[subtreeRoot].getParent();
+        isLeftChild = (up != NIL && pool_[up].left_ == subtreeRoot);
+        parent = up;
+    }
+
+    releaseSlot(curr);
+}
+
+/**
+* Frees an unlinked slot by moving the last node of the pool into it and
+* fixing up the links that pointed at the moved node.
+*/
+template<typename Key, typename Value>
+void CompactAVLTree<Key, Value>::releaseSlot(uint32_t index)
+{
+    uint32_t last = (uint32_t)pool_.size() - 1;
+    if (index != last) {
+        NodeType& moved = pool_[last];
+        replaceChild(moved.getParent(), last, index);
+        if (moved.left_ != NIL) {
+            pool_[moved.left_].setParent(index);
+        }
+        if (moved.right_ != NIL) {
+            pool_[moved.right_].setParent(index);
+        }
+        pool_[index].~NodeType();
+        ::new (&pool_[index]) NodeType(std::move(moved));
+    }
+    pool_.pop_back();
+}
+
+/**
+* Number of levels in the tree, computed iteratively.
+*/
+template<typename Key, typename Value>
+int CompactAVLTree<Key, Value>::height() const
+{
+    int h = 0;
+    std::vector<std::pair<uint32_t, int> > stack;
+    if (root_ != NIL) {
+        stack.push_back(std::make_pair(root_, 1));
+    }
+    while (!stack.empty()) {
+        uint32_t node = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        h = std::max(h, depth);
+        if (pool_[node].left_ != NIL) stack.push_back(std::make_pair(pool_[node].left_, depth + 1));
+        if (pool_[node].right_ != NIL) stack.push_back(std::make_pair(pool_[node].right_, depth + 1));
+    }
+    return h;
+}
+
+template<typename Key, typename Value>
+bool CompactAVLTree<Key, Value>::isBalanced() const
+{
+    return validate();
+}
+
+/**
+* Checks key order, parent links and every balance in one pass. The pool
+* is dense, so the children-before-parents order needed for the heights
+* comes from a breadth-first listing of the nodes, walked backwards; each
+* node is then visited once.
+*/
+template<typename Key, typename Value>
+bool CompactAVLTree<Key, Value>::validate() const
+{
+    if (root_ == NIL) {
+        return pool_.empty();
+    }
+    if (pool_[root_].getParent() != NIL) {
+        return false;
+    }
+    // Breadth-first (level-order) listing; processing it backwards visits
+    // children first
+    std::vector<uint32_t> order;
+    order.reserve(pool_.size());
+    order.push_back(root_);
+    for (size_t i = 0; i < order.size(); ++i) {
+        const NodeType& node = pool_[order[i]];
+        if (node.left_ != NIL) {
+            if (pool_[node.left_].getParent() != order[i]) return false;
+            order.push_back(node.left_);
+        }
+        if (node.right_ != NIL) {
+            if (pool_[node.right_].getParent() != order[i]) return false;
+            order.push_back(node.right_);
+        }
+        if (order.size() > pool_.size()) return false;
+    }
+    if (order.size() != pool_.size()) {
+        return false;
+    }
+    std::vector<int> heights(pool_.size(), 0);
+    std::vector<uint32_t> minNode(pool_.size()), maxNode(pool_.size());
+    for (size_t i = order.size(); i-- > 0; ) {
+        uint32_t n = order[i];
+        const NodeType& node = pool_[n];
+        int lh = node.left_ == NIL ? 0 : heights[node.left_];
+        int rh = node.right_ == NIL ? 0 : heights[node.right_];
+        if (node.getBalance() != rh - lh) return false;
+        if (node.left_ != NIL && !(pool_[maxNode[node.left_]].item_.first < node.item_.first)) return false;
+        if (node.right_ != NIL && !(node.item_.first < pool_[minNode[node.right_]].item_.first)) return false;
+        heights[n] = std::max(lh, rh) + 1;
+        minNode[n] = node.left_ == NIL ? n : minNode[node.left_];
+        maxNode[n] = node.right_ == NIL ? n : maxNode[node.right_];
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <thread>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+using namespace std;
+
+// Benchmark for equalPaths() on large trees.
+// Usage: ./equal-paths-bench [nodes] [max threads]
+//        (defaults: 1000000, std::thread::hardware_concurrency())
+
+// All trees are allocated in one vector so that building and freeing them
+// does not dominate the run.
+struct Forest
+{
+  vector<Node> nodes;
+  Node* root;
+};
+
+// A single left-leaning chain: the deepest possible tree.
+void buildChain(Forest& f, size_t n)
+{
+  f.nodes.assign(n, Node(0));
+  for (size_t i = 0; i + 1 < n; ++i) {
+    f.nodes[i].key = (int)i;
+    f.nodes[i].left = &f.nodes[i + 1];
+  }
+  f.root = n > 0 ? &f.nodes[0] : nullptr;
+}
+
+// A perfect tree in heap order: every leaf at the same depth, so the
+// whole tree has to be visited.
+void buildPerfect(Forest& f, size_t n)
+{
+  f.nodes.assign(n, Node(0));
+  for (size_t i = 0; i < n; ++i) {
+    f.nodes[i].key = (int)i;
+    if (2 * i + 1 < n) f.nodes[i].left = &f.nodes[2 * i + 1];
+    if (2 * i + 2 < n) f.nodes[i].right = &f.nodes[2 * i + 2];
+  }
+  f.root = n > 0 ? &f.nodes[0] : nullptr;
+}
+
+// A random binary search tree built by inserting shuffled keys.
+void buildRandom(Forest& f, size_t n, unsigned seed)
+{
+  vector<int> keys(n);
+  for (size_t i = 0; i < n; ++i) keys[i] = (int)i;
+  shuffle(keys.begin(), keys.end(), mt19937(seed));
+  f.nodes.assign(n, Node(0));
+  f.root = nullptr;
+  for (size_t i = 0; i < n; ++i) {
+    Node* node = &f.nodes[i];
+    node->key = keys[i];
+    Node** link = &f.root;
+    while (*link != nullptr) {
+      link = (node->key < (*link)->key) ? &(*link)->left : &(*link)->right;
+    }
+    *link = node;
+  }
+}
+
+void run(const char* name, Node* root, size_t n)
+{
+  const int reps = 5;
+  bool result = false;
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    result = equalPaths(root);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (elapsed.count() < best) best = elapsed.count();
+  }
+  cout << setw(10) << name << setw(12) << n << setw(8) << boolalpha << result
+       << fixed << setprecision(3) << setw(12) << best * 1e3 << " ms"
+       << setw(10) << setprecision(2) << best * 1e9 / n << " ns/node" << endl;
+}
+
+// Best of a few runs of fn(), in seconds.
+template <typename Fn>
+double bestOf(Fn fn)
+{
+  double best = 1e300;
+  for (int r = 0; r < 5; ++r) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    fn();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+// Speedup of equalPathsParallel() on one perfect tree and of
+// equalPathsBatch() on a forest of perfect trees, from 1 to maxThreads.
+void runParallel(size_t n, unsigned maxThreads)
+{
+  size_t perfect = 1;
+  while (2 * perfect + 1 <= n) perfect = 2 * perfect + 1;
+  Forest big;
+  buildPerfect(big, perfect);
+
+  const size_t trees = 256;
+  size_t small = 1;
+  while (2 * small + 1 <= n / trees) small = 2 * small + 1;
+  vector<Forest> forest(trees);
+  vector<Node*> roots(trees);
+  for (size_t i = 0; i < trees; ++i) {
+    buildPerfect(forest[i], small);
+    roots[i] = forest[i].root;
+  }
+
+  cout << "\nParallel: one tree of " << perfect << " nodes, batch of "
+       << trees << " trees of " << small << " nodes" << endl;
+  cout << setw(10) << "threads" << setw(14) << "single ms" << setw(10) << "speedup"
+       << setw(14) << "batch ms" << setw(10) << "speedup" << endl;
+  double single1 = 0, batch1 = 0;
+  for (unsigned t = 1; t <= maxThreads; t = (t * 2 > maxThreads && t < maxThreads) ? maxThreads : t * 2) {
+    bool ok = true;
+    double single = bestOf([&]() { ok = equalPathsParallel(big.root, t) && ok; });
+    double batch = bestOf([&]() {
+      vector<bool> r = equalPathsBatch(roots, t);
+      for (size_t i = 0; i < r.size(); ++i) ok = r[i] && ok;
+    });
+    if (t == 1) {
+      single1 = single;
+      batch1 = batch;
+    }
+    cout << setw(10) << t << fixed << setprecision(3)
+         << setw(14) << single * 1e3 << setw(10) << setprecision(2) << single1 / single
+         << setprecision(3) << setw(14) << batch * 1e3 << setw(10) << setprecision(2) << batch1 / batch
+         << (ok ? "" : "  WRONG RESULT") << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+  unsigned maxThreads = argc > 2 ? (unsigned)strtoul(argv[2], nullptr, 10) : thread::hardware_concurrency();
+  if (maxThreads == 0) maxThreads = 1;
+  Forest f;
+
+  cout << setw(10) << "tree" << setw(12) << "nodes" << setw(8) << "equal"
+       << setw(15) << "best time" << endl;
+  buildChain(f, n);
+  run("chain", f.root, n);
+  size_t perfect = 1;
+  while (2 * perfect + 1 <= n) perfect = 2 * perfect + 1;
+  buildPerfect(f, perfect);
+  run("perfect", f.root, perfect);
+  buildRandom(f, n, 104);
+  run("random", f.root, n);
+
+  runParallel(n, maxThreads);
+  return 0;
+}
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <thread>
+#include <utility>
+#include "equal-paths-parallel.h"
+using namespace std;
+
+namespace {
+
+// Resolves the "0 = all cores" convention.
+unsigned workerCount(unsigned threads, size_t jobs)
+{
+  if (threads == 0) {
+    threads = thread::hardware_concurrency();
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+  if (jobs < threads) {
+    threads = (unsigned)jobs;
+  }
+  return threads;
+}
+
+// Runs job(i) for every i in [0, jobs) on `threads` workers that pull the
+// next index from a shared counter. The calling thread is one of the workers.
+template <typename Job>
+void runPool(size_t jobs, unsigned threads, Job job)
+{
+  threads = workerCount(threads, jobs);
+  atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next.fetch_add(1); i < jobs; i = next.fetch_add(1)) {
+      job(i);
+    }
+  };
+  vector<thread> pool;
+  for (unsigned t = 1; t < threads; ++t) {
+    pool.push_back(thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < pool.size(); ++t) {
+    pool[t].join();
+  }
+}
+
+// State shared by all workers checking one tree.
+struct SharedDepth
+{
+  atomic<int> leafDepth;   // -1 until the first leaf is found
+  atomic<bool> mismatch;
+
+  SharedDepth() : leafDepth(-1), mismatch(false) {}
+
+  // Records a leaf at the given depth. Returns false on a mismatch.
+  bool leaf(int depth)
+  {
+    int expected = -1;
+    if (!leafDepth.compare_exchange_strong(expected, depth) && expected != depth) {
+      mismatch.store(true, memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+};
+
+// The iterative walk from equalPaths(), starting at a given depth and
+// checking the shared state for cancellation (and picking up the leaf
+// depth found by other workers) every few hundred nodes.
+void checkSubtree(Node* root, int rootDepth, SharedDepth& shared)
+{
+  vector<pair<Node*, int> > stack;
+  stack.push_back(make_pair(root, rootDepth));
+  unsigned steps = 0;
+  int known = shared.leafDepth.load(memory_order_relaxed);
+  while (!stack.empty()) {
+    if ((++steps & 255) == 0) {
+      if (shared.mismatch.load(memory_order_relaxed)) {
+        return;
+      }
+      known = shared.leafDepth.load(memory_order_relaxed);
+    }
+    Node* node = stack.back().first;
+    int depth = stack.back().second;
+    stack.pop_back();
+
+    if (known >= 0 && depth > known) {
+      shared.mismatch.store(true, memory_order_relaxed);
+      return;
+    }
+    if (node->left == nullptr && node->right == nullptr) {
+      if (!shared.leaf(depth)) {
+        return;
+      }
+      known = depth;
+      continue;
+    }
+    if (node->right != nullptr) {
+      stack.push_back(make_pair(node->right, depth + 1));
+    }
+    if (node->left != nullptr) {
+      stack.push_back(make_pair(node->left, depth + 1));
+    }
+  }
+}
+
+}
+
+vector<bool> equalPathsBatch(const vector<Node*>& roots, unsigned threads)
+{
+  // vector<bool> packs bits, so workers write to bytes and we copy at the end
+  vector<char> results(roots.size(), 0);
+  runPool(roots.size(), threads, [&](size_t i) {
+    results[i] = equalPaths(roots[i]);
+  });
+  return vector<bool>(results.begin(), results.end());
+}
+
+bool equalPathsParallel(Node* root, unsigned threads)
+{
+  if (root == nullptr) {
+    return true;
+  }
+  threads = workerCount(threads, (size_t)-1);
+  SharedDepth shared;
+
+  // Expand the top of the tree level by level until there are enough
+  // subtrees to keep every worker busy. Leaves found on the way are
+  // checked right here. A bounded number of levels keeps chains cheap.
+  const size_t wanted = 8 * (size_t)threads;
+  const int maxLevels = 32;
+  vector<pair<Node*, int> > frontier(1, make_pair(root, 0));
+  for (int level = 0; level < maxLevels && frontier.size() < wanted && !frontier.empty(); ++level) {
+    vector<pair<Node*, int> > next;
+    for (size_t i = 0; i < frontier.size(); ++i) {
+      Node* node = frontier[i].first;
+      int depth = frontier[i].second;
+      if (node->left == nullptr && node->right == nullptr) {
+        if (!shared.leaf(depth)) {
+          return false;
+        }
+        continue;
+      }
+      if (node->left != nullptr) {
+        next.push_back(make_pair(node->left, depth + 1));
+      }
+      if (node->right != nullptr) {
+        next.push_back(make_pair(node->right, depth + 1));
+      }
+    }
+    frontier.swap(next);
+  }
+
+  runPool(frontier.size(), threads, [&](size_t i) {
+    if (!shared.mismatch.load(memory_order_relaxed)) {
+      checkSubtree(frontier[i].first, frontier[i].second, shared);
+    }
+  });
+  return !shared.mismatch.load();
+}
@@ -0,0 +1,27 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include <vector>
+#include "equal-paths.h"
+
+/**
+ * @brief Runs equalPaths() on every tree in roots, spreading the trees over
+ *        a pool of worker threads.
+ *
+ * @param roots Roots of the trees to check (null roots count as equal)
+ * @param threads Number of workers; 0 means std::thread::hardware_concurrency()
+ * @return result[i] == equalPaths(roots[i])
+ */
+std::vector<bool> equalPathsBatch(const std::vector<Node*>& roots, unsigned threads = 0);
+
+/**
+ * @brief Same result as equalPaths(root), but the subtrees below the top few
+ *        levels are split across worker threads. All workers share the first
+ *        leaf depth found and stop as soon as any of them finds a mismatch.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param threads Number of workers; 0 means std::thread::hardware_concurrency()
+ */
+bool equalPathsParallel(Node* root, unsigned threads = 0);
+
+#endif
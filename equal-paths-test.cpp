@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 #include "equal-paths.h"
 using namespace std;
 
@@ -55,6 +56,22 @@ void test5(const char* msg)
   cout << msg << ": " <<   equalPaths(a) << endl;
 }
 
+void test6(const char* msg)
+{
+  cout << msg << ": " <<   equalPaths(NULL) << endl;
+}
+
+void test7(const char* msg)
+{
+  // A chain deep enough to overflow a recursive implementation
+  const int depth = 1000000;
+  vector<Node> nodes(depth, Node(0));
+  for(int i = 0; i < depth; i++) {
+    setNode(&nodes[i], i, i + 1 < depth ? &nodes[i + 1] : NULL, NULL);
+  }
+  cout << msg << ": " <<   equalPaths(&nodes[0]) << endl;
+}
+
 int main()
 {
   a = new Node(1);
@@ -67,6 +84,8 @@ int main()
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
+  test7("Test7");
  
   delete a;
   delete b;
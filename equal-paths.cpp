@@ -1,6 +1,7 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
-#include <algorithm>
+#include <vector>
+#include <utility>
 #endif
 
 #include "equal-paths.h"
@@ -8,22 +9,42 @@ using namespace std;
 
 
 // You may add any prototypes of helper functions here
-int dfs(Node* node) {
-  if (node == nullptr)
-    return 0;
-    
-  int leftDepth = 0;
-  int rightDepth = 0;
-  if (node->left != nullptr) {
-    leftDepth = dfs(node->left);
-  }
-  if (node->right != nullptr) {
-    rightDepth = dfs(node->right);
-  }
-  return std::max(leftDepth, rightDepth) + 1;
-}
 
 bool equalPaths(Node * root) {
   // Add your code below
-  return (abs(dfs(root->left) - dfs(root->right)) <= 1);
-}
\ No newline at end of file
+  if (root == nullptr)
+    return true;
+
+  // Depth-first walk with an explicit stack so that very deep trees cannot
+  // overflow the call stack. The first leaf fixes the expected depth and
+  // the walk stops at the first node that proves a mismatch.
+  vector<pair<Node*, int> > stack;
+  stack.push_back(make_pair(root, 0));
+  int leafDepth = -1;
+  while (!stack.empty()) {
+    Node* node = stack.back().first;
+    int depth = stack.back().second;
+    stack.pop_back();
+
+    // Every leaf below a node that is already too deep is too deep as well
+    if (leafDepth >= 0 && depth > leafDepth) {
+      return false;
+    }
+    if (node->left == nullptr && node->right == nullptr) {
+      if (leafDepth < 0) {
+        leafDepth = depth;
+      }
+      else if (depth != leafDepth) {
+        return false;
+      }
+      continue;
+    }
+    if (node->right != nullptr) {
+      stack.push_back(make_pair(node->right, depth + 1));
+    }
+    if (node->left != nullptr) {
+      stack.push_back(make_pair(node->left, depth + 1));
+    }
+  }
+  return true;
+}
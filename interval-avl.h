@@ -0,0 +1,111 @@
+#ifndef INTERVAL_AVL_H
+#define INTERVAL_AVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include "augmented-avl.h"
+
+/**
+* A closed interval [start, end], the key of an IntervalTree. Intervals
+* are ordered by start, then end, so several may share a start.
+*/
+template <typename T>
+struct Interval
+{
+    Interval() : start(), end() {}
+    Interval(const T& s, const T& e) : start(s), end(e) {}
+
+    bool operator==(const Interval& rhs) const { return start == rhs.start && end == rhs.end; }
+    bool operator!=(const Interval& rhs) const { return !(*this == rhs); }
+    bool operator<(const Interval& rhs) const { return start < rhs.start || (!(rhs.start < start) && end < rhs.end); }
+
+    T start;
+    T end;
+};
+
+// Needed by the tree's print()
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const Interval<T>& interval)
+{
+    return out << '[' << interval.start << ", " << interval.end << ']';
+}
+
+/**
+* The monoid of an IntervalTree: the largest interval end in a subtree.
+* Values are ignored.
+*/
+template <typename T>
+struct IntervalEndMonoid
+{
+    typedef T value_type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template <typename Value> static T lift(const Interval<T>& interval, const Value&) { return interval.end; }
+    static T combine(const T& lhs, const T& rhs) { return std::max(lhs, rhs); }
+};
+
+/**
+* An interval tree over closed intervals with start <= end. Each node
+* caches the largest end in its subtree (an AugmentedAVLTree with
+* IntervalEndMonoid), which lets overlapping() skip every subtree that
+* ends before the query does.
+*/
+template <class T, class Value>
+class IntervalTree : public AugmentedAVLTree<Interval<T>, Value, IntervalEndMonoid<T> >
+{
+public:
+    template <typename Fn> void overlapping(const T& a, const T& b, Fn fn) const;
+
+protected:
+    typedef typename AugmentedAVLTree<Interval<T>, Value, IntervalEndMonoid<T> >::AugNode AugNode;
+
+    // Add helper functions here
+    template <typename Fn> void collect(AugNode* node, const T& a, const T& b, Fn& fn) const;
+};
+
+/**
+* Calls fn(item) for every interval that overlaps [a, b], in key order.
+* fn takes a const std::pair<const Interval<T>, Value>& and must not
+* modify the tree.
+*
+* Subtrees whose largest end is below a are skipped, and so is everything
+* that starts after b. Each node visited without being reported lies on
+* the search path for a or b, or above a reported node, so a query
+* reporting k intervals visits O((k + 1) log n) nodes at worst, and close
+* to O(log n + k) when the reported intervals are near each other in the
+* tree.
+*/
+template<class T, class Value>
+template<typename Fn>
+void IntervalTree<T, Value>::overlapping(const T& a, const T& b, Fn fn) const
+{
+    BST_PERF_SCOPE(OP_FIND);
+    collect(static_cast<AugNode*>(this->root_), a, b, fn);
+}
+
+/**
+* In-order walk of the subtree under node for overlapping(). Recursion
+* depth is the subtree's height.
+*/
+template<class T, class Value>
+template<typename Fn>
+void IntervalTree<T, Value>::collect(AugNode* node, const T& a, const T& b, Fn& fn) const
+{
+    if (node == nullptr || node->getAggregate() < a) {
+        return;
+    }
+    BST_PERF_COUNT(SW_NODES_VISITED);
+    collect(node->getLeft(), a, b, fn);
+    if (b < node->getKey().start) {
+        return;
+    }
+    if (this->isLive(node) && !(node->getKey().end < a)) {
+        fn(node->getItem());
+    }
+    collect(node->getRight(), a, b, fn);
+}
+
+#endif
@@ -0,0 +1,762 @@
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+/**
+* A node of a RadixTree. Each node is one allocation: this header followed
+* by its label, the bytes on the edge from the parent (none at the root),
+* so the key of a node is the labels on its path concatenated. children_
+* points to a second allocation holding capacity_ child pointers followed
+* by the first byte of each child's label, in increasing order, so that
+* the child to follow is found with one memchr without touching the
+* children themselves.
+*
+* A RadixNode<int> header is 32 bytes, against 48 for an AVLNode<int, int>
+* and 32 more for a std::string key in it.
+*/
+template <typename Value>
+struct RadixNode
+{
+    RadixNode(RadixNode<Value>* parent, size_t labelLength);
+
+    char* label();
+    const char* label() const;
+    unsigned char* branches();
+    const unsigned char* branches() const;
+
+    RadixNode<Value>* parent_;
+    RadixNode<Value>** children_;
+    uint32_t labelLength_;
+    uint16_t count_;
+    uint16_t capacity_;
+    bool hasValue_;
+    Value value_;
+};
+
+/**
+* An ordered map from std::string keys, with the iterator, find, insert,
+* remove and lower_bound of the search trees, stored as a compressed
+* radix tree (a Patricia trie): each run of bytes that several keys share
+* is stored once, in the label of the node where they branch apart, and
+* a lookup reads each byte of its key once instead of comparing whole
+* keys at every level. This suits keys with long common prefixes, such as
+* URL paths, where BinarySearchTree<std::string, Value> stores every key
+* in full and re-scans the shared prefix in every comparison.
+*
+* Nodes without a value always have two or more children (except the
+* root), so there are fewer than two nodes per key. Keys are ordered as
+* std::string orders them, byte by byte as unsigned char.
+*
+* Since no node stores its whole key, an iterator rebuilds the key from
+* the labels on its path when it is first dereferenced, and dereferences
+* to a pair of references, (key, value), rather than to a stored pair.
+* Inserts invalidate no iterators. A remove may move the node after the
+* removed one to merge labels, so as with CompactAVLTree, removes
+* invalidate iterators. Value must be default constructible.
+*/
+template <typename Value>
+class RadixTree
+{
+public:
+    typedef RadixNode<Value> NodeType;
+
+    // Keys up to 4 GB; a node has at most one child per byte value
+    static const size_t MAX_LABEL = UINT32_MAX;
+
+    RadixTree();
+    ~RadixTree();
+
+    void insert(const std::pair<const std::string, Value>& new_item);
+    void remove(const std::string& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    size_t nodeCount() const;
+    size_t bytesUsed() const;
+    bool validate() const;
+
+    /**
+    * An iterator over the items in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::pair<const std::string&, Value&> reference;
+
+        // What operator-> returns: a holder of the (key, value) pair
+        struct pointer
+        {
+            reference item_;
+            const reference* operator->() const { return &item_; }
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class RadixTree<Value>;
+        explicit iterator(NodeType* node);
+        NodeType* node_;
+        // The key of node_, built on first use
+        mutable std::string key_;
+        mutable bool hasKey_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const std::string& key) const;
+    iterator lower_bound(const std::string& key) const;
+    Value& operator[](const std::string& key);
+    Value const & operator[](const std::string& key) const;
+
+protected:
+    NodeType* internalFind(const std::string& key) const;
+    static NodeType* createNode(NodeType* parent, const char* label, size_t length, size_t labelLength);
+    static void destroyNode(NodeType* node);
+    static size_t childIndex(const NodeType* node, unsigned char byte);
+    static NodeType* firstItem(NodeType* node);
+    static NodeType* nextSubtree(NodeType* node);
+    static void addChild(NodeType* parent, NodeType* child);
+    static void replaceChild(NodeType* parent, NodeType* oldChild, NodeType* newChild);
+    void removeLeaf(NodeType* node);
+    void mergeWithChild(NodeType* node);
+
+    NodeType* root_;
+    size_t size_;
+
+private:
+    RadixTree(const RadixTree&);
+    RadixTree& operator=(const RadixTree&);
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RadixNode class.
+  -----------------------------------------------
+*/
+
+template<typename Value>
+RadixNode<Value>::RadixNode(RadixNode<Value>* parent, size_t labelLength) :
+    parent_(parent), children_(nullptr), labelLength_((uint32_t)labelLength),
+    count_(0), capacity_(0), hasValue_(false), value_()
+{
+
+}
+
+template<typename Value>
+char* RadixNode<Value>::label()
+{
+    return reinterpret_cast<char*>(this + 1);
+}
+
+template<typename Value>
+const char* RadixNode<Value>::label() const
+{
+    return reinterpret_cast<const char*>(this + 1);
+}
+
+template<typename Value>
+unsigned char* RadixNode<Value>::branches()
+{
+    return reinterpret_cast<unsigned char*>(children_ + capacity_);
+}
+
+template<typename Value>
+const unsigned char* RadixNode<Value>::branches() const
+{
+    return reinterpret_cast<const unsigned char*>(children_ + capacity_);
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RadixTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Value>
+RadixTree<Value>::iterator::iterator() :
+    node_(nullptr), hasKey_(false)
+{
+
+}
+
+template<typename Value>
+RadixTree<Value>::iterator::iterator(NodeType* node) :
+    node_(node), hasKey_(false)
+{
+
+}
+
+/**
+* Builds the key from the labels on the path up to the root the first
+* time it is needed.
+*/
+template<typename Value>
+typename RadixTree<Value>::iterator::reference
+RadixTree<Value>::iterator::operator*() const
+{
+    if (!hasKey_) {
+        size_t length = 0;
+        for (const NodeType* node = node_; node != nullptr; node = node->parent_) {
+            length += node->labelLength_;
+        }
+        key_.resize(length);
+        for (const NodeType* node = node_; node != nullptr; node = node->parent_) {
+            length -= node->labelLength_;
+            key_.replace(length, node->labelLength_, node->label(), node->labelLength_);
+        }
+        hasKey_ = true;
+    }
+    return reference(key_, node_->value_);
+}
+
+template<typename Value>
+typename RadixTree<Value>::iterator::pointer
+RadixTree<Value>::iterator::operator->() const
+{
+    pointer p = { **this };
+    return p;
+}
+
+template<typename Value>
+bool RadixTree<Value>::iterator::operator==(const iterator& rhs) const
+{
+    return node_ == rhs.node_;
+}
+
+template<typename Value>
+bool RadixTree<Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return node_ != rhs.node_;
+}
+
+/**
+* Items are visited in preorder, each node before its children, which is
+* key order since a key sorts before every key it is a prefix of.
+*/
+template<typename Value>
+typename RadixTree<Value>::iterator&
+RadixTree<Value>::iterator::operator++()
+{
+    if (node_->count_ > 0) {
+        node_ = firstItem(node_->children_[0]);
+    }
+    else {
+        node_ = nextSubtree(node_);
+    }
+    hasKey_ = false;
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RadixTree class.
+  -----------------------------------------------
+*/
+
+template<typename Value>
+RadixTree<Value>::RadixTree() :
+    root_(createNode(nullptr, "", 0, 0)), size_(0)
+{
+
+}
+
+template<typename Value>
+RadixTree<Value>::~RadixTree()
+{
+    clear();
+    destroyNode(root_);
+}
+
+template<typename Value>
+bool RadixTree<Value>::empty() const
+{
+    return size_ == 0;
+}
+
+template<typename Value>
+size_t RadixTree<Value>::size() const
+{
+    return size_;
+}
+
+/**
+* Frees every node but the root, which is kept empty.
+*/
+template<typename Value>
+void RadixTree<Value>::clear()
+{
+    std::vector<NodeType*> stack(root_->children_, root_->children_ + root_->count_);
+    while (!stack.empty()) {
+        NodeType* node = stack.back();
+        stack.pop_back();
+        stack.insert(stack.end(), node->children_, node->children_ + node->count_);
+        destroyNode(node);
+    }
+    root_->count_ = 0;
+    root_->hasValue_ = false;
+    root_->value_ = Value();
+    size_ = 0;
+}
+
+template<typename Value>
+size_t RadixTree<Value>::nodeCount() const
+{
+    size_t count = 0;
+    std::vector<const NodeType*> stack(1, root_);
+    while (!stack.empty()) {
+        const NodeType* node = stack.back();
+        stack.pop_back();
+        stack.insert(stack.end(), node->children_, node->children_ + node->count_);
+        ++count;
+    }
+    return count;
+}
+
+/**
+* Bytes held by the nodes, their labels and their child arrays (but not
+* allocator overhead).
+*/
+template<typename Value>
+size_t RadixTree<Value>::bytesUsed() const
+{
+    size_t bytes = 0;
+    std::vector<const NodeType*> stack(1, root_);
+    while (!stack.empty()) {
+        const NodeType* node = stack.back();
+        stack.pop_back();
+        stack.insert(stack.end(), node->children_, node->children_ + node->count_);
+        bytes += sizeof(NodeType) + node->labelLength_ + node->capacity_ * (sizeof(NodeType*) + 1);
+    }
+    return bytes;
+}
+
+/**
+* Checks the parent links, that the branch bytes match the children's
+* labels in increasing order, that only the root has an empty label,
+* that every other node without a value has at least two children, and
+* the size.
+*/
+template<typename Value>
+bool RadixTree<Value>::validate() const
+{
+    size_t items = 0;
+    std::vector<const NodeType*> stack(1, root_);
+    while (!stack.empty()) {
+        const NodeType* node = stack.back();
+        stack.pop_back();
+        if (node != root_ && (node->labelLength_ == 0 || (!node->hasValue_ && node->count_ < 2))) {
+            return false;
+        }
+        if (node->count_ > node->capacity_) {
+            return false;
+        }
+        for (size_t i = 0; i < node->count_; ++i) {
+            const NodeType* child = node->children_[i];
+            if (child->parent_ != node || child->labelLength_ == 0
+                || (unsigned char)child->label()[0] != node->branches()[i]) {
+                return false;
+            }
+            if (i > 0 && node->branches()[i - 1] >= node->branches()[i]) {
+                return false;
+            }
+            stack.push_back(child);
+        }
+        items += node->hasValue_;
+    }
+    return items == size_ && root_->parent_ == nullptr && root_->labelLength_ == 0;
+}
+
+template<typename Value>
+typename RadixTree<Value>::iterator
+RadixTree<Value>::begin() const
+{
+    return iterator(firstItem(root_));
+}
+
+template<typename Value>
+typename RadixTree<Value>::iterator
+RadixTree<Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(). The key
+* is copied into the iterator, which is cheaper than rebuilding it from
+* the labels on the path.
+*/
+template<typename Value>
+typename RadixTree<Value>::iterator
+RadixTree<Value>::find(const std::string& key) const
+{
+    iterator it(internalFind(key));
+    if (it.node_ != nullptr) {
+        it.key_ = key;
+        it.hasKey_ = true;
+    }
+    return it;
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none. The descent follows key for as long as a
+* label matches it; where they part, the answer is the first item of the
+* subtree if the label is the larger, or of the next subtree after it if
+* the label is the smaller.
+*/
+template<typename Value>
+typename RadixTree<Value>::iterator
+RadixTree<Value>::lower_bound(const std::string& key) const
+{
+    NodeType* node = root_;
+    size_t pos = 0;
+    while (true) {
+        const char* label = node->label();
+        size_t length = std::min((size_t)node->labelLength_, key.size() - pos);
+        size_t j = 0;
+        while (j < length && label[j] == key[pos + j]) {
+            ++j;
+        }
+        if (j < node->labelLength_) {
+            if (j == key.size() - pos || (unsigned char)key[pos + j] < (unsigned char)label[j]) {
+                return iterator(firstItem(node));
+            }
+            return iterator(nextSubtree(node));
+        }
+        pos += node->labelLength_;
+        if (pos == key.size()) {
+            return iterator(firstItem(node));
+        }
+        const unsigned char* branches = node->branches();
+        unsigned char byte = key[pos];
+        size_t i = 0;
+        while (i < node->count_ && branches[i] < byte) {
+            ++i;
+        }
+        if (i == node->count_) {
+            return iterator(nextSubtree(node));
+        }
+        if (branches[i] != byte) {
+            return iterator(firstItem(node->children_[i]));
+        }
+        node = node->children_[i];
+    }
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Value>
+Value& RadixTree<Value>::operator[](const std::string& key)
+{
+    NodeType* node = internalFind(key);
+    if (node == nullptr) throw std::out_of_range("Invalid key");
+    return node->value_;
+}
+
+template<typename Value>
+Value const & RadixTree<Value>::operator[](const std::string& key) const
+{
+    NodeType* node = internalFind(key);
+    if (node == nullptr) throw std::out_of_range("Invalid key");
+    return node->value_;
+}
+
+/**
+* Inserts the item, overwriting the value if the key is present. Where
+* the key leaves a label part way through, the node is split in two at
+* that point: a new node takes the matched part of the label, and the
+* node keeps the rest (shifted down in place), so iterators stay valid.
+*/
+template<typename Value>
+void RadixTree<Value>::insert(const std::pair<const std::string, Value>& new_item)
+{
+    const std::string& key = new_item.first;
+    if (key.size() > MAX_LABEL) {
+        throw std::length_error("RadixTree key too long");
+    }
+    NodeType* node = root_;
+    size_t pos = 0;
+    while (true) {
+        char* label = node->label();
+        size_t length = std::min((size_t)node->labelLength_, key.size() - pos);
+        size_t j = 0;
+        while (j < length && label[j] == key[pos + j]) {
+            ++j;
+        }
+        if (j < node->labelLength_) {
+            // j > 0 here: the first byte matched to get here, and only the
+            // root, which matches anything, has an empty label
+            NodeType* split = createNode(node->parent_, label, j, j);
+            replaceChild(node->parent_, node, split);
+            node->labelLength_ -= (uint32_t)j;
+            std::memmove(label, label + j, node->labelLength_);
+            node->parent_ = split;
+            addChild(split, node);
+            node = split;
+            pos += j;
+            break;
+        }
+        pos += node->labelLength_;
+        if (pos == key.size()) {
+            break;
+        }
+        size_t i = childIndex(node, key[pos]);
+        if (i == node->count_) {
+            break;
+        }
+        node = node->children_[i];
+    }
+    if (pos < key.size()) {
+        NodeType* leaf = createNode(node, key.data() + pos, key.size() - pos, key.size() - pos);
+        addChild(node, leaf);
+        node = leaf;
+    }
+    if (!node->hasValue_) {
+        node->hasValue_ = true;
+        ++size_;
+    }
+    node->value_ = new_item.second;
+}
+
+/**
+* Removes the item with the given key, if any. A leaf left without a
+* value is freed, and a node left with no value and one child is merged
+* with that child.
+*/
+template<typename Value>
+void RadixTree<Value>::remove(const std::string& key)
+{
+    NodeType* node = internalFind(key);
+    if (node == nullptr) {
+        return;
+    }
+    node->hasValue_ = false;
+    node->value_ = Value();
+    --size_;
+    if (node == root_) {
+        return;
+    }
+    if (node->count_ == 0) {
+        NodeType* parent = node->parent_;
+        removeLeaf(node);
+        if (parent != root_ && !parent->hasValue_ && parent->count_ == 1) {
+            mergeWithChild(parent);
+        }
+    }
+    else if (node->count_ == 1) {
+        mergeWithChild(node);
+    }
+}
+
+/**
+* Returns the node holding key, or null. Each label is compared with
+* memcmp against the next bytes of the key, so every byte of the key is
+* read once.
+*/
+template<typename Value>
+typename RadixTree<Value>::NodeType*
+RadixTree<Value>::internalFind(const std::string& key) const
+{
+    NodeType* node = root_;
+    size_t pos = 0;
+    while (true) {
+        size_t length = node->labelLength_;
+        if (length > key.size() - pos || std::memcmp(node->label(), key.data() + pos, length) != 0) {
+            return nullptr;
+        }
+        pos += length;
+        if (pos == key.size()) {
+            return node->hasValue_ ? node : nullptr;
+        }
+        size_t i = childIndex(node, key[pos]);
+        if (i == node->count_) {
+            return nullptr;
+        }
+        node = node->children_[i];
+    }
+}
+
+/**
+* Allocates a node with room for a label of labelLength bytes in the same
+* block, and copies the first length bytes of it from label.
+*/
+template<typename Value>
+typename RadixTree<Value>::NodeType*
+RadixTree<Value>::createNode(NodeType* parent, const char* label, size_t length, size_t labelLength)
+{
+    void* block = ::operator new(sizeof(NodeType) + labelLength);
+    NodeType* node = ::new (block) NodeType(parent, labelLength);
+    std::memcpy(node->label(), label, length);
+    return node;
+}
+
+template<typename Value>
+void RadixTree<Value>::destroyNode(NodeType* node)
+{
+    ::operator delete(node->children_);
+    node->~NodeType();
+    ::operator delete(node);
+}
+
+/**
+* The index of the child whose label starts with byte, or count_.
+*/
+template<typename Value>
+size_t RadixTree<Value>::childIndex(const NodeType* node, unsigned char byte)
+{
+    if (node->count_ == 0) {
+        return 0;
+    }
+    const void* found = std::memchr(node->branches(), byte, node->count_);
+    return found == nullptr ? node->count_ : (const unsigned char*)found - node->branches();
+}
+
+/**
+* The first node with a value in the subtree of node, which is node
+* itself or found down the first children, or null if the subtree (only
+* possible for an empty root) has none.
+*/
+template<typename Value>
+typename RadixTree<Value>::NodeType*
+RadixTree<Value>::firstItem(NodeType* node)
+{
+    while (!node->hasValue_) {
+        if (node->count_ == 0) {
+            return nullptr;
+        }
+        node = node->children_[0];
+    }
+    return node;
+}
+
+/**
+* The first node with a value after the whole subtree of node, found in
+* the next sibling of node or of its closest ancestor that has one, or
+* null at the end.
+*/
+template<typename Value>
+typename RadixTree<Value>::NodeType*
+RadixTree<Value>::nextSubtree(NodeType* node)
+{
+    while (node->parent_ != nullptr) {
+        NodeType* parent = node->parent_;
+        size_t i = childIndex(parent, node->label()[0]);
+        if (i + 1 < parent->count_) {
+            return firstItem(parent->children_[i + 1]);
+        }
+        node = parent;
+    }
+    return nullptr;
+}
+
+/**
+* Links child under parent, keeping the branch bytes in order. child's
+* label must be non-empty and start with a byte no other child has. The
+* child array doubles when full, up to the 256 possible children.
+*/
+template<typename Value>
+void RadixTree<Value>::addChild(NodeType* parent, NodeType* child)
+{
+    if (parent->count_ == parent->capacity_) {
+        size_t capacity = parent->capacity_ == 0 ? 2 : std::min(2 * (size_t)parent->capacity_, (size_t)256);
+        NodeType** children = static_cast<NodeType**>(::operator new(capacity * (sizeof(NodeType*) + 1)));
+        unsigned char* branches = reinterpret_cast<unsigned char*>(children + capacity);
+        if (parent->count_ > 0) {
+            std::memcpy(children, parent->children_, parent->count_ * sizeof(NodeType*));
+            std::memcpy(branches, parent->branches(), parent->count_);
+        }
+        ::operator delete(parent->children_);
+        parent->children_ = children;
+        parent->capacity_ = (uint16_t)capacity;
+    }
+    unsigned char byte = child->label()[0];
+    unsigned char* branches = parent->branches();
+    size_t i = parent->count_;
+    while (i > 0 && branches[i - 1] > byte) {
+        branches[i] = branches[i - 1];
+        parent->children_[i] = parent->children_[i - 1];
+        --i;
+    }
+    branches[i] = byte;
+    parent->children_[i] = child;
+    ++parent->count_;
+}
+
+/**
+* Puts newChild in oldChild's place under parent. Their labels must start
+* with the same byte.
+*/
+template<typename Value>
+void RadixTree<Value>::replaceChild(NodeType* parent, NodeType* oldChild, NodeType* newChild)
+{
+    parent->children_[childIndex(parent, oldChild->label()[0])] = newChild;
+}
+
+/**
+* Unlinks and frees a node that has no children.
+*/
+template<typename Value>
+void RadixTree<Value>::removeLeaf(NodeType* node)
+{
+    NodeType* parent = node->parent_;
+    size_t i = childIndex(parent, node->label()[0]);
+    unsigned char* branches = parent->branches();
+    for (--parent->count_; i < parent->count_; ++i) {
+        branches[i] = branches[i + 1];
+        parent->children_[i] = parent->children_[i + 1];
+    }
+    destroyNode(node);
+}
+
+/**
+* Replaces node, which has no value and one child, and that child by a
+* single node whose label is the two labels joined, which takes over the
+* child's value and children.
+*/
+template<typename Value>
+void RadixTree<Value>::mergeWithChild(NodeType* node)
+{
+    NodeType* child = node->children_[0];
+    NodeType* merged = createNode(node->parent_, node->label(), node->labelLength_,
+                                  node->labelLength_ + child->labelLength_);
+    std::memcpy(merged->label() + node->labelLength_, child->label(), child->labelLength_);
+    merged->children_ = child->children_;
+    merged->count_ = child->count_;
+    merged->capacity_ = child->capacity_;
+    merged->hasValue_ = child->hasValue_;
+    merged->value_ = std::move(child->value_);
+    child->children_ = nullptr;
+    for (size_t i = 0; i < merged->count_; ++i) {
+        merged->children_[i]->parent_ = merged;
+    }
+    replaceChild(node->parent_, node, merged);
+    destroyNode(child);
+    destroyNode(node);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RadixTree class.
+  -----------------------------------------------
+*/
+
+#endif
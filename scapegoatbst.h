@@ -0,0 +1,215 @@
+#ifndef SCAPEGOATBST_H
+#define SCAPEGOATBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include "bst.h"
+
+/**
+* A scapegoat tree: plain Nodes with no balance field, kept within
+* O(log n) height by occasional rebuilds. An insert that lands deeper than
+* log(maxSize) / log(1 / alpha) walks back up to the first ancestor whose
+* subtree is too lopsided (a child holding more than alpha of its nodes)
+* and rebuilds that subtree into a perfectly balanced shape. A remove that
+* drops the size below alpha * maxSize rebuilds the whole tree.
+*
+* alpha is in (0.5, 1); smaller values keep the tree shallower at the cost
+* of more frequent rebuilds.
+*/
+template <class Key, class Value>
+class ScapegoatTree : public BinarySearchTree<Key, Value>
+{
+public:
+    explicit ScapegoatTree(double alpha = 0.7);
+
+    size_t rebuilds() const;
+    virtual void swap(BinarySearchTree<Key, Value>& other);
+
+protected:
+    virtual void linkNode(Node<Key, Value>* parentNode, Node<Key, Value>* newNode);
+    virtual void detachNode(Node<Key, Value>* node);
+
+    // Add helper functions here
+    int maxDepth() const;
+    static size_t subtreeSize(Node<Key, Value>* subtreeRoot);
+    void rebuild(Node<Key, Value>* subtreeRoot, size_t count);
+    Node<Key, Value>* buildBalanced(size_t lo, size_t hi, Node<Key, Value>* parent);
+
+    double alpha_;
+    size_t maxSize_;
+    size_t rebuilds_;
+    // Reused by every rebuild so that rebuilding does not allocate
+    std::vector<Node<Key, Value>*> scratch_;
+};
+
+template<class Key, class Value>
+ScapegoatTree<Key, Value>::ScapegoatTree(double alpha) :
+    alpha_(alpha), maxSize_(0), rebuilds_(0)
+{
+
+}
+
+/**
+* Returns the number of subtree rebuilds done so far.
+*/
+template<class Key, class Value>
+size_t ScapegoatTree<Key, Value>::rebuilds() const
+{
+    return rebuilds_;
+}
+
+/**
+* Swaps the trees, alpha and rebuild bookkeeping included.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::swap(BinarySearchTree<Key, Value>& other)
+{
+    BinarySearchTree<Key, Value>::swap(other);
+    ScapegoatTree<Key, Value>& tree = static_cast<ScapegoatTree<Key, Value>&>(other);
+    std::swap(alpha_, tree.alpha_);
+    std::swap(maxSize_, tree.maxSize_);
+    std::swap(rebuilds_, tree.rebuilds_);
+    scratch_.swap(tree.scratch_);
+}
+
+/**
+* The deepest a node may sit (root at depth 0) before an insert looks for
+* a scapegoat.
+*/
+template<class Key, class Value>
+int ScapegoatTree<Key, Value>::maxDepth() const
+{
+    return (int)(std::log((double)maxSize_) / -std::log(alpha_));
+}
+
+/**
+* Counts the nodes under subtreeRoot.
+*/
+template<class Key, class Value>
+size_t ScapegoatTree<Key, Value>::subtreeSize(Node<Key, Value>* subtreeRoot)
+{
+    if (subtreeRoot == nullptr) {
+        return 0;
+    }
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> stack(1, subtreeRoot);
+    while (!stack.empty()) {
+        Node<Key, Value>* node = stack.back();
+        stack.pop_back();
+        ++count;
+        if (node->getLeft() != nullptr) stack.push_back(node->getLeft());
+        if (node->getRight() != nullptr) stack.push_back(node->getRight());
+    }
+    return count;
+}
+
+/*
+ * Links the leaf, then measures its depth by climbing to the root and
+ * looks for a scapegoat if it is too deep. Hinted inserts pay for this
+ * climb too.
+ */
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::linkNode(Node<Key, Value>* parentNode, Node<Key, Value>* newNode)
+{
+    if (parentNode == nullptr) {
+        // Also covers a tree emptied by clear()
+        maxSize_ = 0;
+    }
+    BinarySearchTree<Key, Value>::linkNode(parentNode, newNode);
+    if (this->size_ > maxSize_) {
+        maxSize_ = this->size_;
+    }
+    int depth = 0;
+    for (Node<Key, Value>* node = parentNode; node != nullptr; node = node->getParent()) {
+        ++depth;
+    }
+    if (depth <= maxDepth()) {
+        return;
+    }
+
+    // Too deep: some ancestor must be alpha-unbalanced. Sizes are built up
+    // on the way, so only the sibling subtrees are counted.
+    Node<Key, Value>* child = newNode;
+    size_t childSize = 1;
+    for (Node<Key, Value>* node = parentNode; node != nullptr; node = node->getParent()) {
+        Node<Key, Value>* sibling = (child == node->getLeft()) ? node->getRight() : node->getLeft();
+        size_t nodeSize = 1 + childSize + subtreeSize(sibling);
+        if (childSize > alpha_ * nodeSize) {
+            rebuild(node, nodeSize);
+            break;
+        }
+        child = node;
+        childSize = nodeSize;
+    }
+}
+
+/*
+ * Unlinks as in BinarySearchTree, then rebuilds the whole tree once
+ * enough nodes have gone that the depth bound would no longer hold.
+ */
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::detachNode(Node<Key, Value>* node)
+{
+    BinarySearchTree<Key, Value>::detachNode(node);
+    if (this->size_ < alpha_ * maxSize_) {
+        if (this->root_ != nullptr) {
+            rebuild(this->root_, this->size_);
+        }
+        maxSize_ = this->size_;
+    }
+}
+
+/**
+* Rebuilds the count nodes under subtreeRoot into a perfectly balanced
+* subtree in its place. The nodes are gathered in order into scratch_ and
+* relinked, so no node is allocated or freed.
+*/
+template<class Key, class Value>
+void ScapegoatTree<Key, Value>::rebuild(Node<Key, Value>* subtreeRoot, size_t count)
+{
+    ++rebuilds_;
+    Node<Key, Value>* parentNode = subtreeRoot->getParent();
+    bool isLeft = parentNode != nullptr && parentNode->getLeft() == subtreeRoot;
+
+    scratch_.clear();
+    Node<Key, Value>* node = subtreeRoot;
+    while (node->getLeft() != nullptr) {
+        node = node->getLeft();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        scratch_.push_back(node);
+        node = this->successor(node);
+    }
+
+    Node<Key, Value>* newRoot = buildBalanced(0, count, parentNode);
+    if (parentNode == nullptr) {
+        this->root_ = newRoot;
+    } else if (isLeft) {
+        parentNode->setLeft(newRoot);
+    } else {
+        parentNode->setRight(newRoot);
+    }
+}
+
+/**
+* Links scratch_[lo, hi) into a balanced subtree under parent and returns
+* its root. Recursion depth is logarithmic in the subtree size.
+*/
+template<class Key, class Value>
+Node<Key, Value>* ScapegoatTree<Key, Value>::buildBalanced(size_t lo, size_t hi, Node<Key, Value>* parent)
+{
+    if (lo == hi) {
+        return nullptr;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* node = scratch_[mid];
+    node->setParent(parent);
+    node->setLeft(buildBalanced(lo, mid, node));
+    node->setRight(buildBalanced(mid + 1, hi, node));
+    return node;
+}
+
+#endif
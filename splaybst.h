@@ -0,0 +1,269 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. Every find, operator[], insert and
+* remove splays the accessed key to the root (top-down, in one pass), so
+* frequently used keys stay near the root and cost less than O(log n) to
+* reach. Uses plain Nodes; no balance information is stored.
+*
+* Only non-const lookups by Key splay. Lookups through a const SplayTree
+* (or through a BinarySearchTree reference), and find(), lower_bound() and
+* contains() with a key of another type, use the ordinary descent.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+    using BinarySearchTree<Key, Value>::find;
+    using BinarySearchTree<Key, Value>::operator[];
+    using BinarySearchTree<Key, Value>::insert;
+    using BinarySearchTree<Key, Value>::remove;
+
+    virtual void insert(const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    iterator find(const Key& key);
+    template<typename K> iterator find(const K& key);
+    Value& operator[](const Key& key);
+
+protected:
+    virtual void linkNode(Node<Key, Value>* parent, Node<Key, Value>* node);
+    virtual void detachNode(Node<Key, Value>* node);
+    Node<Key, Value>* splay(Node<Key, Value>* subtreeRoot, const Key& key);
+};
+
+/**
+* Top-down splay of the subtree at subtreeRoot. Returns the new subtree
+* root, which holds key if it is present and otherwise the last node on
+* the search path for key. The returned node's parent is set to null.
+*
+* Nodes passed on the way down are hung onto a left tree (keys below key)
+* and a right tree (keys above key); zig-zig steps rotate first. At the end
+* the two trees become the left and right subtrees of the final node.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::splay(Node<Key, Value>* subtreeRoot, const Key& key)
+{
+    // side[LEFT] collects keys below key, side[RIGHT] keys above it;
+    // edge[s] is the node of side[s] nearest to key, where the next node
+    // passed on that side is hung
+    Node<Key, Value>* t = subtreeRoot;
+    Node<Key, Value>* side[2] = { nullptr, nullptr };
+    Node<Key, Value>* edge[2] = { nullptr, nullptr };
+
+    while (true) {
+        BST_PERF_COUNT(SW_NODES_VISITED);
+        bool less = key < t->getKey();
+        if (!less && !(t->getKey() < key)) {
+            break;
+        }
+        bool dir = !less;
+        Node<Key, Value>* y = t->getChild(dir);
+        if (y == nullptr) {
+            break;
+        }
+        if (dir ? (y->getKey() < key) : (key < y->getKey())) {
+            // Zig-zig: rotate t down before linking
+            t->setChild(dir, y->getChild(!dir));
+            if (y->getChild(!dir) != nullptr) {
+                y->getChild(!dir)->setParent(t);
+            }
+            y->setChild(!dir, t);
+            t->setParent(y);
+            t = y;
+            if (dir == Node<Key, Value>::RIGHT) {
+                ++this->leftRotations_;
+            } else {
+                ++this->rightRotations_;
+            }
+            BST_PERF_COUNT(SW_ROTATIONS);
+            if (t->getChild(dir) == nullptr) {
+                break;
+            }
+        }
+        // Link t to the side tree opposite dir, next to key
+        if (side[!dir] == nullptr) {
+            side[!dir] = t;
+        } else {
+            edge[!dir]->setChild(dir, t);
+            t->setParent(edge[!dir]);
+        }
+        edge[!dir] = t;
+        t = t->getChild(dir);
+    }
+
+    // Reassemble: t's subtrees go to the inner edges of the side trees
+    for (int s = Node<Key, Value>::LEFT; s <= Node<Key, Value>::RIGHT; ++s) {
+        if (side[s] == nullptr) {
+            continue;
+        }
+        edge[s]->setChild(!s, t->getChild(s));
+        if (t->getChild(s) != nullptr) {
+            t->getChild(s)->setParent(edge[s]);
+        }
+        t->setChild(s, side[s]);
+        side[s]->setParent(t);
+    }
+    t->setParent(nullptr);
+    return t;
+}
+
+/**
+* Splays key to the root and returns an iterator to it, or end() if the
+* key is not present (the last node on its search path is splayed instead).
+*/
+template<class Key, class Value>
+typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+{
+    BST_PERF_SCOPE(OP_FIND);
+    if (this->root_ != nullptr) {
+        this->root_ = splay(this->root_, key);
+    }
+    // The key, if present, is now at the root, so this is one comparison
+    // (the base find also records the call when tracing)
+    return BinarySearchTree<Key, Value>::find(key);
+}
+
+/**
+* Heterogeneous find on a non-const SplayTree: does not splay, as with a
+* const lookup. Declared here so that a non-Key argument is not ambiguous
+* between find(const Key&) above and the const base template.
+*/
+template<class Key, class Value>
+template<typename K>
+typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::find(const K& key)
+{
+    return BinarySearchTree<Key, Value>::find(key);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key, splaying it to the root
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if (it == this->end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ *
+ * The tree is split around the splayed root and the new node becomes
+ * the root.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item)
+{
+    BST_PERF_SCOPE(OP_INSERT);
+    BST_TRACE_KEY(EV_INSERT, new_item.first);
+    Node<Key, Value>* newNode;
+    if (this->root_ == nullptr) {
+        newNode = this->createNode(new_item, nullptr);
+    } else {
+        Node<Key, Value>* root = splay(this->root_, new_item.first);
+        this->root_ = root;
+        if (!(new_item.first < root->getKey()) && !(root->getKey() < new_item.first)) {
+            this->updateValue(root, new_item.second);
+            return;
+        }
+        newNode = this->createNode(new_item, nullptr);
+        if (new_item.first < root->getKey()) {
+            newNode->setLeft(root->getLeft());
+            newNode->setRight(root);
+            root->setLeft(nullptr);
+        } else {
+            newNode->setRight(root->getRight());
+            newNode->setLeft(root);
+            root->setRight(nullptr);
+        }
+        if (newNode->getLeft() != nullptr) {
+            newNode->getLeft()->setParent(newNode);
+        }
+        if (newNode->getRight() != nullptr) {
+            newNode->getRight()->setParent(newNode);
+        }
+    }
+    this->root_ = newNode;
+    // The new root is an extreme exactly when nothing hangs on that side
+    if (newNode->getLeft() == nullptr) {
+        this->leftmost_ = newNode;
+    }
+    if (newNode->getRight() == nullptr) {
+        this->rightmost_ = newNode;
+    }
+    ++this->size_;
+}
+
+/*
+ * Used by the hinted insert and node insert inherited from
+ * BinarySearchTree: the leaf is linked where the search ended, then
+ * splayed to the root.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::linkNode(Node<Key, Value>* parent, Node<Key, Value>* node)
+{
+    BinarySearchTree<Key, Value>::linkNode(parent, node);
+    this->root_ = splay(this->root_, node->getKey());
+}
+
+/*
+ * Splays the key to the root (even when it is missing, so that the
+ * search path is shortened), then removes it if it is there.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::remove(const Key& key)
+{
+    BST_PERF_SCOPE(OP_REMOVE);
+    BST_TRACE_KEY(EV_REMOVE, key);
+    if (this->root_ == nullptr) {
+        return;
+    }
+    this->root_ = splay(this->root_, key);
+    if (!(key < this->root_->getKey()) && !(this->root_->getKey() < key)) {
+        this->removeNode(this->root_);
+    }
+}
+
+/*
+ * Splays node to the root (a single comparison if it is there already),
+ * then joins its two subtrees by splaying the largest key of the left
+ * subtree to that subtree's root.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::detachNode(Node<Key, Value>* node)
+{
+    const Key& key = node->getKey();
+    Node<Key, Value>* root = splay(this->root_, key);
+
+    Node<Key, Value>* left = root->getLeft();
+    Node<Key, Value>* right = root->getRight();
+    if (left == nullptr) {
+        this->root_ = right;
+        if (right != nullptr) {
+            right->setParent(nullptr);
+        }
+    } else {
+        left->setParent(nullptr);
+        // Every key in left is below key, so this brings left's maximum up
+        left = splay(left, key);
+        left->setRight(right);
+        if (right != nullptr) {
+            right->setParent(left);
+        }
+        this->root_ = left;
+    }
+    --this->size_;
+}
+
+#endif
@@ -0,0 +1,584 @@
+#ifndef STACK_AVL_H
+#define STACK_AVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+/**
+* A node of a StackAVLTree. Unlike AVLNode it has no parent pointer and no
+* vtable, so a StackAVLNode<int, int> is 32 bytes instead of 48.
+*/
+template <typename Key, typename Value>
+struct StackAVLNode
+{
+    StackAVLNode(const Key& key, const Value& value);
+
+    std::pair<const Key, Value> item_;
+    StackAVLNode<Key, Value>* left_;
+    StackAVLNode<Key, Value>* right_;
+    int8_t balance_;
+};
+
+/**
+* An AVL tree whose nodes do not point to their parents. Every operation
+* records the path it descends on a fixed-size stack, insert and remove
+* rebalance by walking that path back up, and iterators carry the stack of
+* ancestors still to be visited.
+*
+* An AVL tree of height MAX_HEIGHT has more than 2^43 nodes, which is more
+* than fits in a 48-bit address space, so the fixed stacks cannot overflow.
+*/
+template <typename Key, typename Value>
+class StackAVLTree
+{
+public:
+    typedef StackAVLNode<Key, Value> NodeType;
+    static const int MAX_HEIGHT = 64;
+
+    StackAVLTree();
+    ~StackAVLTree();
+
+    void insert(const std::pair<const Key, Value>& new_item);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    int height() const;
+    bool isBalanced() const;
+    bool validate() const;
+
+    /**
+    * An in-order iterator. The top of the stack is the current node; below
+    * it are the ancestors whose left subtree contains the current node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key, Value>& operator*() const;
+        std::pair<const Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class StackAVLTree<Key, Value>;
+        void pushLeftSpine(NodeType* node);
+        NodeType* current() const;
+
+        NodeType* stack_[MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    NodeType* internalFind(const Key& key) const;
+    static NodeType* leftRotation(NodeType* startingNode);
+    static NodeType* rightRotation(NodeType* startingNode);
+    static NodeType* rebalance(NodeType* node);
+    void relink(NodeType** path, int index, NodeType* newChild);
+
+    NodeType* root_;
+    size_t size_;
+
+private:
+    StackAVLTree(const StackAVLTree&);
+    StackAVLTree& operator=(const StackAVLTree&);
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the StackAVLNode class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>::StackAVLNode(const Key& key, const Value& value) :
+    item_(key, value), left_(nullptr), right_(nullptr), balance_(0)
+{
+
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the StackAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+StackAVLTree<Key, Value>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+void StackAVLTree<Key, Value>::iterator::pushLeftSpine(NodeType* node)
+{
+    while (node != nullptr) {
+        stack_[depth_++] = node;
+        node = node->left_;
+    }
+}
+
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::iterator::current() const
+{
+    return depth_ == 0 ? nullptr : stack_[depth_ - 1];
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& StackAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current()->item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>* StackAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current()->item_);
+}
+
+template<typename Key, typename Value>
+bool StackAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<typename Key, typename Value>
+bool StackAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Pops the current node and, if it has a right subtree, descends to the
+* smallest node of that subtree.
+*/
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::iterator&
+StackAVLTree<Key, Value>::iterator::operator++()
+{
+    NodeType* node = stack_[--depth_];
+    pushLeftSpine(node->right_);
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the StackAVLTree class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+const int StackAVLTree<Key, Value>::MAX_HEIGHT;
+
+template<typename Key, typename Value>
+StackAVLTree<Key, Value>::StackAVLTree() :
+    root_(nullptr), size_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+StackAVLTree<Key, Value>::~StackAVLTree()
+{
+    clear();
+}
+
+template<typename Key, typename Value>
+bool StackAVLTree<Key, Value>::empty() const
+{
+    return root_ == nullptr;
+}
+
+template<typename Key, typename Value>
+size_t StackAVLTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+template<typename Key, typename Value>
+void StackAVLTree<Key, Value>::clear()
+{
+    std::vector<NodeType*> stack;
+    if (root_ != nullptr) {
+        stack.push_back(root_);
+    }
+    while (!stack.empty()) {
+        NodeType* node = stack.back();
+        stack.pop_back();
+        if (node->left_ != nullptr) stack.push_back(node->left_);
+        if (node->right_ != nullptr) stack.push_back(node->right_);
+        delete node;
+    }
+    root_ = nullptr;
+    size_ = 0;
+}
+
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Builds the iterator while descending: only the ancestors we leave to the
+* left are kept, since those are the ones iteration still has to visit.
+*/
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it;
+    NodeType* curr = root_;
+    while (curr != nullptr) {
+        if (key < curr->item_.first) {
+            it.stack_[it.depth_++] = curr;
+            curr = curr->left_;
+        } else if (curr->item_.first < key) {
+            curr = curr->right_;
+        } else {
+            it.stack_[it.depth_++] = curr;
+            return it;
+        }
+    }
+    it.depth_ = 0;
+    return it;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Key, typename Value>
+Value& StackAVLTree<Key, Value>::operator[](const Key& key)
+{
+    NodeType* curr = internalFind(key);
+    if (curr == nullptr) throw std::out_of_range("Invalid key");
+    return curr->item_.second;
+}
+
+template<typename Key, typename Value>
+Value const & StackAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    NodeType* curr = internalFind(key);
+    if (curr == nullptr) throw std::out_of_range("Invalid key");
+    return curr->item_.second;
+}
+
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    NodeType* curr = root_;
+    while (curr != nullptr) {
+        if (key < curr->item_.first) {
+            curr = curr->left_;
+        } else if (curr->item_.first < key) {
+            curr = curr->right_;
+        } else {
+            break;
+        }
+    }
+    return curr;
+}
+
+/**
+* Rotates startingNode down to the left and returns the new subtree root.
+* The caller links the returned node into startingNode's old place.
+*/
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::leftRotation(NodeType* startingNode)
+{
+    NodeType* rightChild = startingNode->right_;
+    startingNode->right_ = rightChild->left_;
+    rightChild->left_ = startingNode;
+
+    int8_t startBalance = startingNode->balance_ - 1 - std::max<int8_t>(rightChild->balance_, 0);
+    startingNode->balance_ = startBalance;
+    rightChild->balance_ = rightChild->balance_ - 1 + std::min<int8_t>(startBalance, 0);
+    return rightChild;
+}
+
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::rightRotation(NodeType* startingNode)
+{
+    NodeType* leftChild = startingNode->left_;
+    startingNode->left_ = leftChild->right_;
+    leftChild->right_ = startingNode;
+
+    int8_t startBalance = startingNode->balance_ + 1 - std::min<int8_t>(leftChild->balance_, 0);
+    startingNode->balance_ = startBalance;
+    leftChild->balance_ = leftChild->balance_ + 1 + std::max<int8_t>(startBalance, 0);
+    return leftChild;
+}
+
+/**
+* Fixes a node whose balance is +/-2 with a single or double rotation and
+* returns the new subtree root.
+*/
+template<typename Key, typename Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::rebalance(NodeType* node)
+{
+    if (node->balance_ == 2) {
+        if (node->right_->balance_ == -1) {
+            node->right_ = rightRotation(node->right_);
+        }
+        return leftRotation(node);
+    } else {
+        if (node->left_->balance_ == 1) {
+            node->left_ = leftRotation(node->left_);
+        }
+        return rightRotation(node);
+    }
+}
+
+/**
+* Replaces path[index] by newChild in its parent, which is path[index - 1]
+* (or the root for index 0).
+*/
+template<typename Key, typename Value>
+void StackAVLTree<Key, Value>::relink(NodeType** path, int index, NodeType* newChild)
+{
+    if (index == 0) {
+        root_ = newChild;
+    } else if (path[index - 1]->left_ == path[index]) {
+        path[index - 1]->left_ = newChild;
+    } else {
+        path[index - 1]->right_ = newChild;
+    }
+    path[index] = newChild;
+}
+
+/*
+ * If key is already in the tree, the value is overwritten.
+ */
+template<typename Key, typename Value>
+void StackAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    NodeType* path[MAX_HEIGHT];
+    bool wentLeft[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* curr = root_;
+    while (curr != nullptr) {
+        if (new_item.first < curr->item_.first) {
+            wentLeft[depth] = true;
+        } else if (curr->item_.first < new_item.first) {
+            wentLeft[depth] = false;
+        } else {
+            curr->item_.second = new_item.second;
+            return;
+        }
+        path[depth++] = curr;
+        curr = wentLeft[depth - 1] ? curr->left_ : curr->right_;
+    }
+
+    NodeType* newNode = new NodeType(new_item.first, new_item.second);
+    ++size_;
+    if (depth == 0) {
+        root_ = newNode;
+        return;
+    }
+    if (wentLeft[depth - 1]) {
+        path[depth - 1]->left_ = newNode;
+    } else {
+        path[depth - 1]->right_ = newNode;
+    }
+
+    // Walk the descent path back up while the subtree we came from grew
+    for (int i = depth - 1; i >= 0; --i) {
+        NodeType* node = path[i];
+        node->balance_ += wentLeft[i] ? -1 : 1;
+        if (node->balance_ == 0) {
+            break;
+        } else if (node->balance_ == 2 || node->balance_ == -2) {
+            relink(path, i, rebalance(node));
+            break;
+        }
+    }
+}
+
+/*
+ * A node with two children trades places with its predecessor, as in
+ * AVLTree::remove, and is then unlinked from the predecessor's position.
+ */
+template<typename Key, typename Value>
+void StackAVLTree<Key, Value>::remove(const Key& key)
+{
+    NodeType* path[MAX_HEIGHT];
+    bool wentLeft[MAX_HEIGHT];
+    int depth = 0;
+
+    NodeType* curr = root_;
+    while (curr != nullptr) {
+        if (key < curr->item_.first) {
+            wentLeft[depth] = true;
+        } else if (curr->item_.first < key) {
+            wentLeft[depth] = false;
+        } else {
+            break;
+        }
+        path[depth++] = curr;
+        curr = wentLeft[depth - 1] ? curr->left_ : curr->right_;
+    }
+    if (curr == nullptr) {
+        return;
+    }
+
+    if (curr->left_ != nullptr && curr->right_ != nullptr) {
+        // Extend the path down to the predecessor
+        int currIndex = depth;
+        path[depth] = curr;
+        wentLeft[depth++] = true;
+        NodeType* pred = curr->left_;
+        while (pred->right_ != nullptr) {
+            path[depth] = pred;
+            wentLeft[depth++] = false;
+            pred = pred->right_;
+        }
+
+        // Swap the two nodes' positions and balances
+        NodeType* predLeft = pred->left_;
+        pred->right_ = curr->right_;
+        pred->left_ = (curr->left_ == pred) ? curr : curr->left_;
+        std::swap(pred->balance_, curr->balance_);
+        if (path[depth - 1] != curr) {
+            path[depth - 1]->right_ = curr;
+        }
+        curr->left_ = predLeft;
+        curr->right_ = nullptr;
+        relink(path, currIndex, pred);
+    }
+
+    NodeType* child = (curr->left_ != nullptr) ? curr->left_ : curr->right_;
+    if (depth == 0) {
+        root_ = child;
+    } else if (wentLeft[depth - 1]) {
+        path[depth - 1]->left_ = child;
+    } else {
+        path[depth - 1]->right_ = child;
+    }
+    delete curr;
+    --size_;
+
+    // Walk the path back up while the subtree we came from got shorter
+    for (int i = depth - 1; i >= 0; --i) {
+        NodeType* node = path[i];
+        node->balance_ += wentLeft[i] ? 1 : -1;
+        if (node->balance_ == 1 || node->balance_ == -1) {
+            break;
+        } else if (node->balance_ == 2 || node->balance_ == -2) {
+            NodeType* subtreeRoot = rebalance(node);
+            relink(path, i, subtreeRoot);
+            if (subtreeRoot->balance_ != 0) {
+                break; // Rotated subtree kept its height
+            }
+        }
+    }
+}
+
+/**
+* Number of levels in the tree, computed iteratively.
+*/
+template<typename Key, typename Value>
+int StackAVLTree<Key, Value>::height() const
+{
+    int h = 0;
+    std::vector<std::pair<NodeType*, int> > stack;
+    if (root_ != nullptr) {
+        stack.push_back(std::make_pair(root_, 1));
+    }
+    while (!stack.empty()) {
+        NodeType* node = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        h = std::max(h, depth);
+        if (node->left_ != nullptr) stack.push_back(std::make_pair(node->left_, depth + 1));
+        if (node->right_ != nullptr) stack.push_back(std::make_pair(node->right_, depth + 1));
+    }
+    return h;
+}
+
+template<typename Key, typename Value>
+bool StackAVLTree<Key, Value>::isBalanced() const
+{
+    return validate();
+}
+
+/**
+* Checks key order, balances and the node count in one iterative
+* post-order pass.
+*/
+template<typename Key, typename Value>
+bool StackAVLTree<Key, Value>::validate() const
+{
+    struct Summary { int height; NodeType* min; NodeType* max; };
+    std::vector<std::pair<NodeType*, bool> > stack;
+    std::vector<Summary> summaries;
+    size_t count = 0;
+    if (root_ != nullptr) {
+        stack.push_back(std::make_pair(root_, false));
+    }
+    while (!stack.empty()) {
+        NodeType* node = stack.back().first;
+        if (!stack.back().second) {
+            stack.back().second = true;
+            if (node->right_ != nullptr) stack.push_back(std::make_pair(node->right_, false));
+            if (node->left_ != nullptr) stack.push_back(std::make_pair(node->left_, false));
+            continue;
+        }
+        stack.pop_back();
+        ++count;
+        Summary left = { 0, nullptr, nullptr };
+        Summary right = { 0, nullptr, nullptr };
+        if (node->right_ != nullptr) {
+            right = summaries.back();
+            summaries.pop_back();
+        }
+        if (node->left_ != nullptr) {
+            left = summaries.back();
+            summaries.pop_back();
+        }
+        if (node->balance_ != right.height - left.height) return false;
+        if (node->balance_ < -1 || node->balance_ > 1) return false;
+        if (left.max != nullptr && !(left.max->item_.first < node->item_.first)) return false;
+        if (right.min != nullptr && !(node->item_.first < right.min->item_.first)) return false;
+        Summary merged = { std::max(left.height, right.height) + 1,
+                           left.min != nullptr ? left.min : node,
+                           right.max != nullptr ? right.max : node };
+        summaries.push_back(merged);
+    }
+    return count == size_;
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "bst.h"
+#include "avlbst.h"
+#include "compact-avl.h"
+#include "stack-avl.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "scapegoatbst.h"
+#include "bst-trace.h"
+
+using namespace std;
+using namespace bsttrace;
+
+// Replays a trace recorded with -DBST_TRACE (see bst-trace.h) against
+// the tree variants and std::map, reporting throughput and per-call
+// latency percentiles.
+// Usage: ./tree-replay [-t tree,...] [-p passes] trace
+// Trees: bst avl avl-lazy rb splay scapegoat compact stack map. The
+// default is all but bst, which a sorted trace would make quadratic.
+//
+// Each tree replays the trace passes times untimed per call, keeping
+// the best throughput, then once more timing every call. Values are not
+// in the trace, so an insert stores the index of the call. The trace's
+// begin() and ++ calls drive a single cursor. CompactAVLTree and
+// StackAVLTree have no lower_bound, so they replay it as a find.
+
+typedef chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps the optimizer from dropping lookups whose results are unused.
+volatile long benchSink;
+
+const char* eventNames[NUM_EVENTS] = { "insert", "remove", "find", "lower_bound", "begin", "next", "clear" };
+
+// A decoded trace: one entry in events per call, and one entry in keys
+// per call that has a key, in the same order.
+template<typename Key>
+struct Trace
+{
+    vector<unsigned char> events;
+    vector<Key> keys;
+};
+
+// Reads the events after the header. Returns false on a truncated or
+// corrupt trace.
+template<typename Key>
+bool readTrace(istream& in, Trace<Key>& trace)
+{
+    int byte;
+    while ((byte = in.get()) != EOF) {
+        if (byte >= NUM_EVENTS) {
+            return false;
+        }
+        trace.events.push_back((unsigned char)byte);
+        if (hasKey((Event)byte)) {
+            Key key;
+            if (!KeyCodec<Key>::read(in, key)) {
+                return false;
+            }
+            trace.keys.push_back(key);
+        }
+    }
+    return true;
+}
+
+// The calls that differ between the trees and std::map. Inserts
+// overwrite, as the trees' insert does.
+template<typename Tree, typename Key>
+void replayInsert(Tree& tree, const Key& key, long value)
+{
+    tree.insert(make_pair(key, value));
+}
+
+template<typename Key>
+void replayInsert(map<Key, long>& tree, const Key& key, long value)
+{
+    tree[key] = value;
+}
+
+template<typename Tree, typename Key>
+void replayRemove(Tree& tree, const Key& key)
+{
+    tree.remove(key);
+}
+
+template<typename Key>
+void replayRemove(map<Key, long>& tree, const Key& key)
+{
+    tree.erase(key);
+}
+
+// An AVLTree that removes lazily, compacting at half tombstones.
+template<typename Key>
+class LazyAVLTree : public AVLTree<Key, long>
+{
+public:
+    LazyAVLTree() { this->enableLazyRemove(0.5); }
+};
+
+// A trace has no idle time to compact in, so the remove that crosses the
+// ratio pays for it, and the latencies show the pause.
+template<typename Key>
+void replayRemove(LazyAVLTree<Key>& tree, const Key& key)
+{
+    tree.remove(key);
+    if (tree.needsCompaction()) {
+        tree.compact();
+    }
+}
+
+template<typename Tree, typename Key>
+typename Tree::iterator replayLowerBound(Tree& tree, const Key& key)
+{
+    return tree.lower_bound(key);
+}
+
+template<typename Key>
+typename CompactAVLTree<Key, long>::iterator replayLowerBound(CompactAVLTree<Key, long>& tree, const Key& key)
+{
+    return tree.find(key);
+}
+
+template<typename Key>
+typename StackAVLTree<Key, long>::iterator replayLowerBound(StackAVLTree<Key, long>& tree, const Key& key)
+{
+    return tree.find(key);
+}
+
+// Replays the call at events[i], whose key (if it has one) is key.
+// Returns 1 if the call found or reached an item, for benchSink.
+template<typename Tree, typename Key>
+long replayCall(Tree& tree, typename Tree::iterator& cursor, unsigned char event, const Key& key, long i)
+{
+    switch (event) {
+    case EV_INSERT:
+        replayInsert(tree, key, i);
+        return 0;
+    case EV_REMOVE:
+        replayRemove(tree, key);
+        return 0;
+    case EV_FIND:
+        return tree.find(key) != tree.end();
+    case EV_LOWER_BOUND:
+        return replayLowerBound(tree, key) != tree.end();
+    case EV_BEGIN:
+        cursor = tree.begin();
+        return cursor != tree.end();
+    case EV_NEXT:
+        if (cursor != tree.end()) {
+            ++cursor;
+        }
+        return cursor != tree.end();
+    case EV_CLEAR:
+        tree.clear();
+        cursor = tree.end();
+        return 0;
+    }
+    return 0;
+}
+
+// Replays the whole trace on tree, timing each call into latencies if
+// it is not null.
+template<typename Tree, typename Key>
+long replayTrace(Tree& tree, const Trace<Key>& trace, vector<vector<unsigned> >* latencies)
+{
+    typename Tree::iterator cursor = tree.end();
+    static const Key noKey = Key();
+    long found = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < trace.events.size(); ++i) {
+        unsigned char event = trace.events[i];
+        const Key& key = hasKey((Event)event) ? trace.keys[k++] : noKey;
+        if (latencies == nullptr) {
+            found += replayCall(tree, cursor, event, key, (long)i);
+        }
+        else {
+            Clock::time_point start = Clock::now();
+            found += replayCall(tree, cursor, event, key, (long)i);
+            Clock::time_point end = Clock::now();
+            (*latencies)[event].push_back((unsigned)chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+        }
+    }
+    return found;
+}
+
+unsigned percentile(const vector<unsigned>& sorted, double q)
+{
+    return sorted[(size_t)(q * (sorted.size() - 1))];
+}
+
+template<typename Tree, typename Key>
+void replayOn(const char* name, const Trace<Key>& trace, int passes)
+{
+    double best = 0;
+    for (int p = 0; p < passes; ++p) {
+        Tree tree;
+        Clock::time_point start = Clock::now();
+        benchSink = replayTrace(tree, trace, (vector<vector<unsigned> >*)nullptr);
+        double seconds = secondsSince(start);
+        if (p == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    vector<vector<unsigned> > latencies(NUM_EVENTS);
+    {
+        Tree tree;
+        benchSink = replayTrace(tree, trace, &latencies);
+    }
+
+    cout << fixed << setprecision(2);
+    cout << setw(12) << name << setw(12) << trace.events.size() / best / 1e6 << " Mcalls/s" << endl;
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        vector<unsigned>& sorted = latencies[e];
+        if (sorted.empty()) {
+            continue;
+        }
+        sort(sorted.begin(), sorted.end());
+        cout << setw(16) << eventNames[e] << setw(12) << sorted.size()
+             << setw(10) << percentile(sorted, 0.5) << setw(10) << percentile(sorted, 0.9)
+             << setw(10) << percentile(sorted, 0.99) << setw(10) << percentile(sorted, 0.999)
+             << setw(10) << sorted.back() << endl;
+    }
+}
+
+
+// The smallest gap between two clock reads, which every latency includes.
+unsigned timerOverhead()
+{
+    unsigned least = ~0u;
+    for (int i = 0; i < 1000; ++i) {
+        Clock::time_point start = Clock::now();
+        Clock::time_point end = Clock::now();
+        least = min(least, (unsigned)chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+    }
+    return least;
+}
+
+template<typename Key>
+int replayAll(istream& in, const char* kindName, const vector<string>& trees, int passes)
+{
+    Trace<Key> trace;
+    if (!readTrace(in, trace)) {
+        cerr << "Truncated or corrupt trace" << endl;
+        return 1;
+    }
+    vector<size_t> counts(NUM_EVENTS);
+    for (size_t i = 0; i < trace.events.size(); ++i) {
+        ++counts[trace.events[i]];
+    }
+    cout << "Trace of " << trace.events.size() << " calls on " << kindName << " keys:";
+    for (int e = 0; e < NUM_EVENTS; ++e) {
+        if (counts[e] > 0) {
+            cout << " " << eventNames[e] << " " << counts[e];
+        }
+    }
+    cout << endl;
+    if (trace.events.empty()) {
+        return 0;
+    }
+    cout << "Latencies in ns, including about " << timerOverhead() << " ns of timer overhead" << endl;
+    cout << setw(12) << "tree" << setw(12) << "throughput" << endl;
+    cout << setw(16) << "call" << setw(12) << "count" << setw(10) << "p50" << setw(10) << "p90"
+         << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "max" << endl;
+
+    for (size_t t = 0; t < trees.size(); ++t) {
+        const char* name = trees[t].c_str();
+        if (trees[t] == "bst") {
+            replayOn<BinarySearchTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "avl") {
+            replayOn<AVLTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "avl-lazy") {
+            replayOn<LazyAVLTree<Key> >(name, trace, passes);
+        }
+        else if (trees[t] == "rb") {
+            replayOn<RedBlackTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "splay") {
+            replayOn<SplayTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "scapegoat") {
+            replayOn<ScapegoatTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "compact") {
+            replayOn<CompactAVLTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "stack") {
+            replayOn<StackAVLTree<Key, long> >(name, trace, passes);
+        }
+        else if (trees[t] == "map") {
+            replayOn<map<Key, long> >(name, trace, passes);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<string> trees;
+    int passes = 3;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            stringstream list(argv[++i]);
+            string name;
+            while (getline(list, name, ',')) {
+                trees.push_back(name);
+            }
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            passes = max(1, atoi(argv[++i]));
+        }
+        else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr) {
+        cerr << "Usage: " << argv[0] << " [-t tree,...] [-p passes] trace" << endl;
+        return 1;
+    }
+    const char* known[] = { "bst", "avl", "avl-lazy", "rb", "splay", "scapegoat", "compact", "stack", "map" };
+    if (trees.empty()) {
+        trees.assign(known + 1, known + sizeof(known) / sizeof(known[0]));
+    }
+    for (size_t t = 0; t < trees.size(); ++t) {
+        if (find(known, known + sizeof(known) / sizeof(known[0]), trees[t]) == known + sizeof(known) / sizeof(known[0])) {
+            cerr << "Unknown tree " << trees[t] << endl;
+            return 1;
+        }
+    }
+
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cerr << "Cannot open " << path << endl;
+        return 1;
+    }
+    switch (readHeader(in)) {
+    case 'i':
+        return replayAll<long long>(in, "signed integer", trees, passes);
+    case 'u':
+        return replayAll<unsigned long long>(in, "unsigned integer", trees, passes);
+    case 'f':
+        return replayAll<double>(in, "floating point", trees, passes);
+    case 's':
+        return replayAll<string>(in, "string", trees, passes);
+    }
+    cerr << path << " is not a tree trace" << endl;
+    return 1;
+}
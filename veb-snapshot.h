@@ -0,0 +1,291 @@
+#ifndef VEB_SNAPSHOT_H
+#define VEB_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "bst.h"
+
+/**
+* A read-only snapshot of a BinarySearchTree (such as an AVLTree) whose
+* keys are stored in van Emde Boas order: a complete binary search tree
+* of height h is split into a top tree of height h/2 and the bottom trees
+* hanging from it, the top tree is stored first, then each bottom tree
+* after it, and every one of them is laid out the same way recursively.
+*
+* Whatever the block size B of a cache level (a cache line, a page, ...),
+* a descent then crosses O(log n / log B) blocks instead of the O(log n)
+* of a pointer-based tree or of a binary search on a sorted array, with
+* no block size to tune. There are no child pointers: the position of the
+* next node is computed from its breadth-first index and a few per-depth
+* constants (Brodal, Fagerberg and Jacob, "Cache oblivious search trees
+* via binary trees of small height", SODA 2002).
+*
+* The tree is padded to 2^h - 1 slots with copies of the largest key, so
+* the key array holds up to twice as many keys as the snapshot. Items are
+* kept in a separate sorted array, read only once a search has ended, and
+* iterators are iterators into it. A snapshot does not change after it is
+* built; it does not follow later changes to the tree it was built from.
+*/
+template <typename Key, typename Value>
+class VebSnapshot
+{
+public:
+    typedef typename std::vector<std::pair<const Key, Value> >::const_iterator iterator;
+
+    static const int MAX_HEIGHT = 64;
+
+    explicit VebSnapshot(const BinarySearchTree<Key, Value>& tree);
+
+    bool empty() const;
+    size_t size() const;
+    int height() const;
+    size_t bytesUsed() const;
+    bool validate() const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+
+protected:
+    void splitLevels(int depth, int height);
+    void place(uint64_t index, int depth, size_t* pos);
+    size_t lowerBoundRank(const Key& key, size_t& keyPos) const;
+    size_t rankOf(uint64_t index, int depth) const;
+
+    // All the items in key order
+    std::vector<std::pair<const Key, Value> > items_;
+    // The keys of the padded complete tree in van Emde Boas order
+    std::vector<Key> keys_;
+    int height_;
+
+    // For a node at depth d (the root is at depth 1), the depth of the
+    // root of the top tree it hangs from, the size of that top tree and
+    // the size of each bottom tree, as the recursive split left them
+    int topDepth_[MAX_HEIGHT + 1];
+    size_t topSize_[MAX_HEIGHT + 1];
+    size_t bottomSize_[MAX_HEIGHT + 1];
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the VebSnapshot class.
+  ------------------------------------------------
+*/
+
+/**
+* Copies the items of tree, in key order, and lays out their keys. O(n).
+*/
+template<typename Key, typename Value>
+VebSnapshot<Key, Value>::VebSnapshot(const BinarySearchTree<Key, Value>& tree) :
+    height_(0)
+{
+    items_.reserve(tree.size());
+    for (typename BinarySearchTree<Key, Value>::iterator it = tree.begin(); it != tree.end(); ++it) {
+        items_.push_back(*it);
+    }
+    if (items_.empty()) {
+        return;
+    }
+    while (((uint64_t)1 << height_) - 1 < items_.size()) {
+        ++height_;
+    }
+    keys_.assign(((size_t)1 << height_) - 1, items_.back().first);
+    splitLevels(1, height_);
+    size_t pos[MAX_HEIGHT + 1];
+    pos[1] = 0;
+    place(1, 1, pos);
+}
+
+template<typename Key, typename Value>
+bool VebSnapshot<Key, Value>::empty() const
+{
+    return items_.empty();
+}
+
+template<typename Key, typename Value>
+size_t VebSnapshot<Key, Value>::size() const
+{
+    return items_.size();
+}
+
+/**
+* The height of the padded tree, ceil(log2(size() + 1)).
+*/
+template<typename Key, typename Value>
+int VebSnapshot<Key, Value>::height() const
+{
+    return height_;
+}
+
+/**
+* Bytes held by the key and item arrays.
+*/
+template<typename Key, typename Value>
+size_t VebSnapshot<Key, Value>::bytesUsed() const
+{
+    return keys_.capacity() * sizeof(Key) + items_.capacity() * sizeof(std::pair<const Key, Value>);
+}
+
+/**
+* Checks that a search for every key ends at its own item, which holds
+* only if the layout is a search tree over the items in order.
+*/
+template<typename Key, typename Value>
+bool VebSnapshot<Key, Value>::validate() const
+{
+    for (size_t rank = 0; rank < items_.size(); ++rank) {
+        size_t keyPos;
+        if (lowerBoundRank(items_[rank].first, keyPos) != rank) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Key, typename Value>
+typename VebSnapshot<Key, Value>::iterator
+VebSnapshot<Key, Value>::begin() const
+{
+    return items_.begin();
+}
+
+template<typename Key, typename Value>
+typename VebSnapshot<Key, Value>::iterator
+VebSnapshot<Key, Value>::end() const
+{
+    return items_.end();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().
+*/
+template<typename Key, typename Value>
+typename VebSnapshot<Key, Value>::iterator
+VebSnapshot<Key, Value>::find(const Key& key) const
+{
+    // The key found is compared in the key array, where the search has
+    // just read it, rather than in items_
+    size_t keyPos;
+    size_t rank = lowerBoundRank(key, keyPos);
+    if (rank == items_.size() || key < keys_[keyPos]) {
+        return end();
+    }
+    return items_.begin() + rank;
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none.
+*/
+template<typename Key, typename Value>
+typename VebSnapshot<Key, Value>::iterator
+VebSnapshot<Key, Value>::lower_bound(const Key& key) const
+{
+    size_t keyPos;
+    return items_.begin() + lowerBoundRank(key, keyPos);
+}
+
+/**
+* Fills in the per-depth constants for a (sub)tree of the given height
+* whose root is at depth: its top tree takes the upper height / 2 levels
+* and the roots of its bottom trees are at depth + height / 2.
+*/
+template<typename Key, typename Value>
+void VebSnapshot<Key, Value>::splitLevels(int depth, int height)
+{
+    if (height <= 1) {
+        return;
+    }
+    int top = height / 2;
+    int bottom = height - top;
+    topDepth_[depth + top] = depth;
+    topSize_[depth + top] = ((size_t)1 << top) - 1;
+    bottomSize_[depth + top] = ((size_t)1 << bottom) - 1;
+    splitLevels(depth, top);
+    splitLevels(depth + top, bottom);
+}
+
+/**
+* Stores the keys of the subtree whose root has breadth-first index index
+* (the root is 1) at the given depth. pos[d] holds the position of the
+* node at depth d on the path down to it, and pos[depth] is already set.
+* Subtrees holding only padding are skipped, as keys_ starts out filled
+* with the padding key.
+*/
+template<typename Key, typename Value>
+void VebSnapshot<Key, Value>::place(uint64_t index, int depth, size_t* pos)
+{
+    // The in-order rank of the leftmost node of the subtree
+    if (((index - ((uint64_t)1 << (depth - 1))) << (height_ - depth + 1)) >= items_.size()) {
+        return;
+    }
+    size_t rank = rankOf(index, depth);
+    if (rank < items_.size()) {
+        keys_[pos[depth]] = items_[rank].first;
+    }
+    if (depth == height_) {
+        return;
+    }
+    for (uint64_t child = 2 * index; child <= 2 * index + 1; ++child) {
+        int d = depth + 1;
+        pos[d] = pos[topDepth_[d]] + topSize_[d] + (child & topSize_[d]) * bottomSize_[d];
+        place(child, d, pos);
+    }
+}
+
+/**
+* The rank of the first item whose key is not less than key, or size()
+* if there is none; keyPos is set to the position of its key in keys_.
+* Every descent goes all the way down, without an equality test, so it
+* ends below a leaf at breadth-first index 2^h + r, r being the number
+* of keys less than key. The padding at the right, being equal to the
+* largest key, does not move r below size() when key is larger.
+*/
+template<typename Key, typename Value>
+size_t VebSnapshot<Key, Value>::lowerBoundRank(const Key& key, size_t& keyPos) const
+{
+    keyPos = 0;
+    if (height_ == 0) {
+        return 0;
+    }
+    size_t pos[MAX_HEIGHT + 1];
+    pos[1] = 0;
+    uint64_t index = 1;
+    size_t lastLeft = 0;
+    for (int depth = 1; ; ++depth) {
+        // Selects rather than branches: the direction is a coin toss
+        bool right = keys_[pos[depth]] < key;
+        lastLeft = right ? lastLeft : pos[depth];
+        index = 2 * index + right;
+        if (depth == height_) {
+            break;
+        }
+        int d = depth + 1;
+        pos[d] = pos[topDepth_[d]] + topSize_[d] + (index & topSize_[d]) * bottomSize_[d];
+    }
+    keyPos = lastLeft;
+    size_t rank = (size_t)(index - ((uint64_t)1 << height_));
+    return rank < items_.size() ? rank : items_.size();
+}
+
+/**
+* The in-order rank of the node with breadth-first index index at the
+* given depth of the padded tree.
+*/
+template<typename Key, typename Value>
+size_t VebSnapshot<Key, Value>::rankOf(uint64_t index, int depth) const
+{
+    uint64_t offset = index - ((uint64_t)1 << (depth - 1));
+    return (size_t)(((2 * offset + 1) << (height_ - depth)) - 1);
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the VebSnapshot class.
+  ----------------------------------------------
+*/
+
+#endif